@@ -9,9 +9,15 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <math.h>
 #include <unistd.h>
 #include <time.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // Constants definition
 
@@ -29,8 +35,26 @@
 
 // Maximum tree height for the Min-Max algorithm (Computer AI)
 // Ten is not proved to be optimal, but was tested and never lost
+// It is the default, the height can be changed in the engine settings
 #define MAX_TREE_HEIGHT 10
 
+// A win is worth SCORE_PER_HEIGHT for each level between the state and the
+// maximum height, so closer wins are better
+#define SCORE_PER_HEIGHT 10
+// Limit of the static evaluation at the maximum height (less than a win)
+#define MAX_EVALUATION (SCORE_PER_HEIGHT - 1)
+
+// Number of lines (rows, columns and diagonals) of the board
+#define NUM_LINES (2 * BOARD_SIZE + 2)
+
+// Evaluation tuning
+// Feature differences are limited to [-limit, limit] on the tuning table
+#define TUNING_FEATURE_LIMIT 9
+#define TUNING_STEPS 500
+#define TUNING_LEARNING_RATE 0.5
+// The largest tuned weight is scaled to this value
+#define TUNING_WEIGHT_SCALE 4
+
 // Max number of moves is the degree of the middle node
 // There are 9 nodes in the board and 6 pieces
 // So there can be at most 3 moves for each piece of the player
@@ -39,6 +63,203 @@
 // Maximum number of turns in the game
 #define MAX_TURNS 30
 
+// Game record stream format
+// The file starts with the magic string and the format version. Each record
+// is: variant (1 byte), seed (8 bytes, little-endian), number of moves
+// (1 byte), one byte per move (origin node * NUM_NODES + destiny node) and
+// the result (1 byte, the winner id or id_empty for a draw)
+#define RECORD_MAGIC "PDGR"
+#define RECORD_MAGIC_SIZE 4
+#define RECORD_VERSION 1
+#define RECORD_HEADER_SIZE 10
+// Each turn has two moves
+#define MAX_RECORD_MOVES (MAX_TURNS * 2)
+// Size of the buffers used to read and write the records
+#define RECORD_BUFFER_SIZE (1 << 16)
+
+// Variant identifiers stored in the game records
+#define VARIANT_CLASSIC 0
+#define VARIANT_SHISIMA 1
+#define VARIANT_TAPATAN 2
+#define VARIANT_ACHI 3
+#define NUM_VARIANTS 4
+
+// Script replay
+// Size of the output buffer of the replay results
+#define REPLAY_OUTPUT_SIZE (1 << 16)
+
+// Position index
+// Sets of NUM_PIECES nodes among NUM_NODES: C(9, 3)
+#define NUM_PIECE_SETS 84
+// Sets of NUM_PIECES nodes among the NUM_NODES - NUM_PIECES nodes left by
+// the other player: C(6, 3)
+#define NUM_FREE_PIECE_SETS 20
+// Positions with each turn player: C(9, 3) * C(6, 3) * 2
+#define NUM_POSITION_INDICES (NUM_PIECE_SETS * NUM_FREE_PIECE_SETS * 2)
+// Most sets of nodes with any number of pieces: C(9, 4)
+#define MAX_PIECE_SETS 126
+// Marks the masks without the number of pieces on the rank tables
+#define POSITION_INDEX_INVALID 255
+
+// Snapshot file of the live games
+#define SNAPSHOT_MAGIC "PDGS"
+#define SNAPSHOT_MAGIC_SIZE 4
+#define SNAPSHOT_VERSION 1
+// Magic, version and number of games
+#define SNAPSHOT_HEADER_SIZE 9
+// The file is written with this suffix and then renamed
+#define SNAPSHOT_TEMP_SUFFIX ".tmp"
+// Size of the snapshot of a game (see snapshot_game)
+#define GAME_SNAPSHOT_SIZE (70 + MAX_RECORD_MOVES)
+
+// Spectators
+// Number of events kept for the spectators (a power of 2)
+#define SPECTATOR_RING_SIZE 256
+// A spectator this many events behind skips to the latest event, before the
+// event it would read can be overwritten
+#define SPECTATOR_MAX_LAG (SPECTATOR_RING_SIZE / 2)
+// Size of the text of an event (a line and the board)
+#define SPECTATOR_FRAME_SIZE (RENDER_BUFFER_SIZE + 128)
+// Move of the events that are not moves
+#define SPECTATOR_NO_MOVE (NUM_NODES * NUM_NODES)
+
+// Game database index (named after the record file)
+#define INDEX_SUFFIX ".idx"
+#define INDEX_MAGIC "PDGI"
+#define INDEX_MAGIC_SIZE 4
+#define INDEX_VERSION 1
+// Magic, version, padding, number of games and number of positions
+#define INDEX_HEADER_SIZE 16
+// Directory entry: offset (8 bytes), size, occurrences, results and games
+// (4 bytes each)
+#define INDEX_KEY_ENTRY_SIZE 32
+// Varint of the game number (up to 10 bytes), ply, next move and result
+#define INDEX_MAX_ENTRY_SIZE 13
+// Next move of the last position of a game
+#define INDEX_NO_MOVE (NUM_NODES * NUM_NODES)
+// Games listed by a query
+#define INDEX_LISTED_GAMES 20
+
+// Proof-number search
+// Default number of nodes of the search tree
+#define PROOF_DEFAULT_NODES (1 << 20)
+// Nodes of the search of the proof-number engine on each move
+#define PROOF_ENGINE_NODES (1 << 16)
+// Entries of the table of solved positions: one for each position and
+// number of moves left
+#define PROOF_TABLE_SIZE (NUM_POSITION_INDICES * (MAX_RECORD_MOVES + 1))
+// Proof number of a disproven node (and disproof number of a proven one)
+#define PROOF_INFINITY 1000000000u
+
+// Latency histograms
+// Each power of two is split in 2^LATENCY_SUB_BUCKET_BITS buckets, so the
+// values are stored with a relative error below 12.5%
+#define LATENCY_SUB_BUCKET_BITS 3
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BUCKET_BITS)
+// Enough buckets for any 64 bits value
+#define LATENCY_BUCKETS (64 * LATENCY_SUB_BUCKETS)
+// Game phases by number of moves played
+#define OPENING_PLIES 10
+#define MIDDLEGAME_PLIES 30
+
+// Tournament
+#define MAX_TOURNAMENT_CONFIGS 16
+#define TOURNAMENT_NAME_SIZE 64
+// Games of each pair of configurations with each colour
+#define TOURNAMENT_DEFAULT_GAMES 2
+
+// Load-adaptive scheduler
+// Degradation levels: full budget, height - 2, half height, minimum height
+#define SCHEDULER_LEVELS 4
+#define SCHEDULER_MIN_HEIGHT 2
+// Priorities of the games (0 is the highest): a game of priority p uses
+// the active level minus (SCHEDULER_PRIORITIES - 1 - p)
+#define SCHEDULER_PRIORITIES 3
+// Moves waiting per thread before the queue counts as overloaded
+#define SCHEDULER_QUEUE_PER_THREAD 8
+// Moves played after a change of the level before it can go down
+#define SCHEDULER_HOLD_MOVES 16
+// Weight of the last move on the recent latency
+#define SCHEDULER_LATENCY_WEIGHT 0.1
+// Target latency of a move, waiting time included (milliseconds)
+#define SCHEDULER_DEFAULT_LATENCY 100
+
+// Search tracing
+// Spans below this height of the search tree are not recorded by default
+#define TRACE_DEFAULT_HEIGHT 2
+#define TRACE_INITIAL_EVENTS 1024
+// Events per thread (the next ones are dropped)
+#define TRACE_MAX_EVENTS (1 << 20)
+#define TRACE_WRITE_BUFFER_SIZE (1 << 16)
+
+// Search tree dump
+// The file has a header (magic and version) and a record of
+// TREE_DUMP_RECORD_SIZE bytes for each node (see write_tree_dump_node)
+#define TREE_DUMP_MAGIC "PDGT"
+#define TREE_DUMP_MAGIC_SIZE 4
+#define TREE_DUMP_VERSION 1
+#define TREE_DUMP_HEADER_SIZE 8
+#define TREE_DUMP_RECORD_SIZE 16
+// Records kept by each thread before they are written
+#define TREE_DUMP_BUFFER_SIZE (TREE_DUMP_RECORD_SIZE * 4096)
+// Move of the roots
+#define TREE_DUMP_NO_MOVE (NUM_NODES * NUM_NODES)
+// Children of each node shown by the DOT conversion and its maximum height
+#define TREE_DOT_DEFAULT_TOP 3
+#define TREE_DOT_DEFAULT_HEIGHT 3
+
+// Board rendering
+// Size of the buffer of a frame (the board has about 150 characters)
+#define RENDER_BUFFER_SIZE 512
+// Number of lines of a frame
+#define RENDER_FRAME_LINES (3 + 2 * BOARD_SIZE)
+// Terminal line of the first row of pieces and column of the first piece
+// (used to redraw only the changed cells)
+#define RENDER_FIRST_ROW_LINE 5
+#define RENDER_FIRST_COLUMN 7
+
+// Compact position notation: the cells row by row (PLAYER_1, PLAYER_2 or
+// EMPTY), a space and the symbol of the turn player, e.g. "OOO+++XXX X"
+#define NOTATION_SIZE (NUM_NODES + 2)
+
+// Fast search check
+// Longest random walk used to generate the positions (up to the last move
+// before the turn limit, so the searches near the limit are checked too)
+#define VERIFY_MAX_WALK (MAX_RECORD_MOVES - 1)
+
+// Analysis tool
+// Number of positions read, analyzed and written at a time
+#define ANALYSIS_BATCH_SIZE 1024
+// Maximum size of an input line and of an output line
+#define ANALYSIS_LINE_SIZE 128
+
+// Game graph file
+#define GRAPH_MAGIC "PDGG"
+#define GRAPH_MAGIC_SIZE 4
+#define GRAPH_VERSION 1
+// Magic, version, variant, padding, number of nodes and number of edges
+#define GRAPH_HEADER_SIZE 16
+// Attributes of a node: turn player (bit 0), terminal position (bit 1) and
+// winner (bits 2 and 3, id_empty without a winner)
+#define GRAPH_TERMINAL 2
+#define GRAPH_WINNER_SHIFT 2
+
+// Solver file
+#define SOLVER_MAGIC "PDGV"
+#define SOLVER_MAGIC_SIZE 4
+#define SOLVER_VERSION 1
+// Magic, version, variant, pieces, state, number of passes, padding and
+// number of positions (the bit arrays start aligned)
+#define SOLVER_HEADER_SIZE 24
+// State of a file whose last pass decided nothing
+#define SOLVER_DONE 1
+
+// Review of recorded games
+// Number of games read, reviewed and written at a time
+#define REVIEW_BATCH_GAMES 256
+// Maximum size of an output line
+#define REVIEW_LINE_SIZE 128
+
 // Player index enumeration
 typedef enum {
     id_player_1,
@@ -46,12 +267,215 @@ typedef enum {
     id_empty
 } PlayerIndex;
 
+// Features of the static evaluation
+typedef enum {
+    // Number of valid moves
+    feature_mobility,
+    // Piece on the centre node
+    feature_center,
+    // Winning lines with two pieces and the third cell empty
+    feature_threats,
+    // Pieces missing on the closest winning line
+    feature_line_distance,
+    NUM_EVAL_FEATURES
+} EvalFeature;
+
+// Result of the proof-number search
+typedef enum {
+    // The turn player has a forced win
+    proof_proven,
+    // The turn player has no forced win before the turn limit
+    proof_disproven,
+    // The node limit was reached
+    proof_unknown
+} ProofStatus;
+
+// Search used by the computer player
+typedef enum {
+    engine_minimax,
+    // Proof-number search for a forced win, minimax otherwise
+    engine_proof_number,
+    // Minimax on a flat array of cells (same scores, no tree to reuse)
+    engine_fast
+} EngineType;
+
+// Phases of the game (used on the latency statistics)
+typedef enum {
+    phase_opening,
+    phase_middlegame,
+    phase_endgame,
+    NUM_GAME_PHASES
+} GamePhase;
+
+// Players of the interactive games
+typedef enum {
+    game_player_vs_player,
+    // The computer is player 2
+    game_player_vs_computer,
+    // The computer is player 1
+    game_computer_vs_player,
+    NUM_GAME_MODES
+} GameMode;
+
+// Events published to the spectators
+typedef enum {
+    spectator_game_start,
+    spectator_move,
+    spectator_game_end
+} SpectatorEventType;
+
+// Result of a move submitted to a game (move_ok if the move was played)
+typedef enum {
+    move_ok,
+    move_invalid_origin,
+    move_invalid_destiny,
+    // No piece of the turn player on the origin
+    move_not_own_piece,
+    move_same_position,
+    move_not_adjacent,
+    move_occupied,
+    // The game is over
+    move_game_over,
+    // The turn player is the computer
+    move_not_player_turn
+} MoveError;
+
+// State of an interactive game
+typedef enum {
+    // The turn player is a person (submit_move plays the turn)
+    game_waiting_player,
+    // The turn player is the computer (step_game plays the turn)
+    game_waiting_computer,
+    game_finished
+} GameStatus;
+
+// Categories of the memory allocated by the engine
+typedef enum {
+    // Boards and adjacency matrices
+    memory_boards,
+    // Search tree (create_board_state)
+    memory_board_states,
+    // Moves (add_move_if_valid and the moves returned by the searches)
+    memory_moves,
+    // Arrays of moves of list_valid_moves
+    memory_move_lists,
+    // Nodes and tables of the proof-number search
+    memory_proof_search,
+    // Computer players
+    memory_engines,
+    NUM_MEMORY_CATEGORIES
+} MemoryCategory;
+
+// Counters of the review of recorded games
+typedef enum {
+    review_moves,
+    review_blunders,
+    review_missed_wins,
+    review_illegal,
+    NUM_REVIEW_COUNTS
+} ReviewCount;
+
+// Board rendering modes
+typedef enum {
+    // The whole board is printed on every frame
+    render_full,
+    // Only the changed cells are redrawn (terminals only)
+    render_diff,
+    // The board is not printed
+    render_quiet
+} RenderMode;
+
+// Why the search stopped at a node of the tree dump
+typedef enum {
+    // All the children were searched
+    cutoff_none,
+    // A child is a win for the turn player, so the next ones were skipped
+    cutoff_win_found,
+    // The turn player has a winning move (no children are created)
+    cutoff_winning_move,
+    // Maximum height (static evaluation)
+    cutoff_horizon,
+    // The game ends as a draw before a line can be completed
+    cutoff_turn_limit,
+    // Win or loss proven by the previous search
+    cutoff_cached,
+    // The turn player has no valid moves (draw)
+    cutoff_no_moves,
+    NUM_CUTOFF_REASONS
+} CutoffReason;
+
+// Result of a replayed script line
+typedef enum {
+    // All moves were played and the game did not end
+    replay_in_progress,
+    replay_win,
+    replay_draw,
+    replay_illegal_move,
+    // The line has something that is not a list of moves
+    replay_malformed
+} ReplayStatus;
+
+// Nodes of each line of the board: rows, columns and diagonals
+// The row of index 0 is the initial row of player 2 and the row of index
+// BOARD_SIZE - 1 is the initial row of player 1
+const int BOARD_LINES[NUM_LINES][BOARD_SIZE] = {
+    {0, 1, 2}, {3, 4, 5}, {6, 7, 8},
+    {0, 3, 6}, {1, 4, 7}, {2, 5, 8},
+    {0, 4, 8}, {2, 4, 6}
+};
+
 // Struct prototypes
 typedef struct Position Position;
 typedef struct Move Move;
 typedef struct AdjacencyMatrix AdjacencyMatrix;
 typedef struct Board Board;
 typedef struct BoardState BoardState;
+typedef struct Rng Rng;
+typedef struct LatencyHistogram LatencyHistogram;
+typedef struct MemoryHeader MemoryHeader;
+typedef struct MemoryAccount MemoryAccount;
+typedef struct MemoryWindow MemoryWindow;
+typedef struct EngineConfig EngineConfig;
+typedef struct Engine Engine;
+typedef struct BoardRenderer BoardRenderer;
+typedef struct TraceEvent TraceEvent;
+typedef struct TournamentGame TournamentGame;
+typedef struct RulesDefinition RulesDefinition;
+typedef struct Rules Rules;
+typedef struct PositionIndex PositionIndex;
+typedef struct IndexKeyEntry IndexKeyEntry;
+typedef struct FastSearch FastSearch;
+typedef struct Tournament Tournament;
+typedef struct EngineScheduler EngineScheduler;
+typedef struct LoadGame LoadGame;
+typedef struct LoadTest LoadTest;
+typedef struct TraceBuffer TraceBuffer;
+typedef struct Tracer Tracer;
+typedef struct TreeDumpBuffer TreeDumpBuffer;
+typedef struct TreeDump TreeDump;
+typedef struct TreeDumpNode TreeDumpNode;
+typedef struct GameRecord GameRecord;
+typedef struct GameRecordWriter GameRecordWriter;
+typedef struct GameRecordReader GameRecordReader;
+typedef struct GameSettings GameSettings;
+typedef struct Game Game;
+typedef struct ThreadPool ThreadPool;
+typedef struct ThreadPoolWorker ThreadPoolWorker;
+typedef struct AnalysisResult AnalysisResult;
+typedef struct AnalysisBatch AnalysisBatch;
+typedef struct ReviewItem ReviewItem;
+typedef struct ReviewBatch ReviewBatch;
+typedef struct GameGraph GameGraph;
+typedef struct Solver Solver;
+typedef struct ReplayResult ReplayResult;
+typedef struct ProofNode ProofNode;
+typedef struct ProofTableEntry ProofTableEntry;
+typedef struct ProofSearch ProofSearch;
+typedef struct ProofResult ProofResult;
+typedef struct SpectatorEvent SpectatorEvent;
+typedef struct Spectator Spectator;
+typedef struct SpectatorThread SpectatorThread;
+typedef struct SpectatorFeed SpectatorFeed;
 
 // Struct definitions
 typedef struct Position {
@@ -75,6 +499,8 @@ typedef struct Board {
     int** table;
     int turn_player;
     int winner;
+    // Number of moves played
+    int ply;
     // AdjacencyMatrix* adj_matrix;
 } Board;
 
@@ -86,10 +512,670 @@ typedef struct BoardState {
     int num_children;
     // Child number (index) in the parent's children array
     int child_number;
+    // Number (index) of the move that leads to this state in the
+    // list_valid_moves order of the parent
+    int move_number;
     int height;
     int score;
+    // Number of the node on the search tree dump (0 if not dumped)
+    int dump_id;
 } BoardState;
 
+// Random number generator (xoshiro256**)
+typedef struct Rng {
+    uint64_t state[4];
+} Rng;
+
+// Histogram with logarithmic buckets
+typedef struct LatencyHistogram {
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t max;
+} LatencyHistogram;
+
+// Kept before each block of malloc_tracked (16 bytes, so the block keeps
+// the alignment of malloc)
+typedef struct MemoryHeader {
+    uint64_t size;
+    uint32_t category;
+    // Counted on the shared counters of the categories
+    uint32_t shared;
+} MemoryHeader;
+
+// Memory counters of a category
+typedef struct MemoryAccount {
+    long long bytes;
+    long long peak_bytes;
+    long long allocations;
+} MemoryAccount;
+
+// Counters of the thread at the start of a computer move
+typedef struct MemoryWindow {
+    long long start_bytes;
+    long long start_allocations;
+} MemoryWindow;
+
+// Settings of the computer player
+typedef struct EngineConfig {
+    EngineType type;
+    // Keep the search tree between turns to speed up the next search
+    bool reuse_tree;
+    // Height where the search stops
+    int max_height;
+    // Evaluate the states at the maximum height instead of using a draw
+    bool use_evaluation;
+    int eval_weights[NUM_EVAL_FEATURES];
+    // Limit of nodes of the searches (0 for the default of each search)
+    // The minimax search deepens while the next height fits in the limit
+    int max_nodes;
+} EngineConfig;
+
+// State owned by each instance of the computer player
+typedef struct Engine {
+    EngineConfig config;
+    // Used to break ties between moves with the same score
+    Rng rng;
+    // Tree of the last search (NULL if there is none)
+    BoardState* tree;
+    // Child of the tree for the move played by the computer
+    BoardState* played_state;
+    // Cells of the board after the computer move
+    int played_cells[NUM_NODES];
+    // Player the tree was searched for
+    int computer_id;
+    // Maximum height of the search of the tree (the scores of wins and
+    // losses depend on it)
+    int tree_max_height;
+    // Time of each computer move (microseconds) by number of moves played
+    LatencyHistogram move_latency[MAX_RECORD_MOVES];
+    // CPU time of all moves (nanoseconds) and number of moves
+    uint64_t cpu_time;
+    long long num_moves;
+    // Peak bytes in use and number of allocations of each move
+    LatencyHistogram move_memory;
+    LatencyHistogram move_allocations;
+} Engine;
+
+typedef struct BoardRenderer {
+    RenderMode mode;
+    // The frame is built here and written with a single call
+    char buffer[RENDER_BUFFER_SIZE];
+    // Cells of the last frame (used to find the changed cells)
+    int last_cells[NUM_NODES];
+    bool has_frame;
+} BoardRenderer;
+
+typedef struct GameRecord {
+    int variant;
+    uint64_t seed;
+    int num_moves;
+    // Moves encoded as origin node * NUM_NODES + destiny node
+    unsigned char moves[MAX_RECORD_MOVES];
+    // Winner id or id_empty for a draw
+    int result;
+} GameRecord;
+
+typedef struct GameRecordWriter {
+    FILE* file;
+    // Records are accumulated here and written with a single call when full
+    unsigned char buffer[RECORD_BUFFER_SIZE];
+    int used;
+} GameRecordWriter;
+
+typedef struct GameRecordReader {
+    FILE* file;
+    // Only a fixed window of the file is kept in memory
+    unsigned char buffer[RECORD_BUFFER_SIZE];
+    int used;
+    int position;
+} GameRecordReader;
+
+typedef struct GameSettings {
+    // Seed of the random number generator
+    uint64_t seed;
+    // Where the finished games are recorded (NULL if not recording)
+    GameRecordWriter* record_writer;
+    // Number of threads used by the bulk commands
+    int num_threads;
+    // How the board is shown on the game loops
+    BoardRenderer* renderer;
+    // Print the statistics of the engine at the end
+    bool print_stats;
+    // Rules of the computer games (VARIANT_CLASSIC for the board game)
+    int variant;
+    // Computer player of the game loops
+    Engine* engine;
+    // Where the live games are saved after every move (NULL if not saving)
+    const char* checkpoint_path;
+    // Snapshots of the games waiting to be resumed after the current one
+    unsigned char* waiting_games;
+    int num_waiting_games;
+    // Where the games are published to the spectators (NULL if none)
+    SpectatorFeed* spectators;
+} GameSettings;
+
+// Event of a game, with the whole position after it, so a spectator that
+// skips events can continue from any of them
+typedef struct SpectatorEvent {
+    // Number of the event (starting at 1; 0 while it is being written)
+    uint64_t sequence;
+    SpectatorEventType type;
+    // Number of the game on the feed (starting at 1)
+    int game;
+    unsigned char cells[NUM_NODES];
+    unsigned char turn_player;
+    unsigned char ply;
+    unsigned char winner;
+    // Move played (origin * 9 + destiny) or SPECTATOR_NO_MOVE
+    unsigned char move;
+    // Text of the event, rendered once for all the spectators
+    int frame_length;
+    char frame[SPECTATOR_FRAME_SIZE];
+} SpectatorEvent;
+
+// Reader of a feed (a position on the ring, no copy of the events)
+typedef struct Spectator {
+    SpectatorFeed* feed;
+    // Number of the next event to read
+    uint64_t next_sequence;
+    long long events_read;
+    long long events_skipped;
+    // Where the frames are written (NULL to only read them)
+    FILE* output;
+} Spectator;
+
+// Thread that reads the events for a share of the spectators
+typedef struct SpectatorThread {
+    SpectatorFeed* feed;
+    pthread_t thread;
+    // Serves the spectators index, index + num_threads, ...
+    int index;
+} SpectatorThread;
+
+// Ring of events written by the games and read by all the spectators
+// There is a single writer; the spectators read the events in place
+typedef struct SpectatorFeed {
+    SpectatorEvent events[SPECTATOR_RING_SIZE];
+    // Number of the last event published
+    uint64_t published;
+    int num_games;
+    // Time spent publishing the events
+    uint64_t publish_time;
+    // Wakes the spectators waiting for an event
+    pthread_mutex_t mutex;
+    pthread_cond_t event_ready;
+    bool closed;
+    Spectator* spectators;
+    int num_spectators;
+    SpectatorThread* threads;
+    int num_threads;
+} SpectatorFeed;
+
+// Interactive game
+// The board turn player is the player of the next move
+typedef struct Game {
+    GameMode mode;
+    GameStatus status;
+    Board* board;
+    AdjacencyMatrix* adj_matrix;
+    // Computer player (NULL on player vs player)
+    Engine* engine;
+    // Moves played (the board ply is the number of moves)
+    GameRecord record;
+    Move last_move;
+} Game;
+
+typedef struct ReplayResult {
+    ReplayStatus status;
+    // Number of moves played
+    int num_moves;
+    // Number of the illegal move (starting at 1)
+    int bad_move;
+} ReplayResult;
+
+typedef struct ProofNode {
+    unsigned char cells[NUM_NODES];
+    unsigned char turn_player;
+    // Moves until the game ends as a draw
+    unsigned char plies_left;
+    // Move from the parent (origin node * NUM_NODES + destiny node)
+    short move;
+    // Moves until the win of a proven node
+    unsigned char length;
+    uint32_t proof;
+    uint32_t disproof;
+    int parent;
+    // Children are stored in sequence in the pool
+    int first_child;
+    int num_children;
+} ProofNode;
+
+typedef struct ProofTableEntry {
+    // False for a position that was not solved yet
+    bool solved;
+    bool proven;
+    unsigned char length;
+} ProofTableEntry;
+
+typedef struct ProofSearch {
+    // Pool of nodes (the tree is bounded by max_nodes)
+    ProofNode* nodes;
+    int num_nodes;
+    int max_nodes;
+    // Results of solved positions, reused when they appear again
+    ProofTableEntry* table;
+    // Player trying to prove the win
+    int attacker;
+    int neighbors[NUM_NODES][MAX_MOVES];
+    int num_neighbors[NUM_NODES];
+} ProofSearch;
+
+typedef struct ProofResult {
+    ProofStatus status;
+    // Number of moves of the proof (until the win)
+    int length;
+    // Main line of the proof (encoded moves)
+    unsigned char moves[MAX_RECORD_MOVES];
+    int num_moves;
+    long long nodes;
+} ProofResult;
+
+// Function executed for each item of a thread pool job
+// The worker index can be used to access per thread data
+typedef void (*TaskFunction)(void* context, int item, int worker);
+
+typedef struct ThreadPoolWorker {
+    ThreadPool* pool;
+    int index;
+} ThreadPoolWorker;
+
+typedef struct ThreadPool {
+    pthread_t* threads;
+    ThreadPoolWorker* workers;
+    int num_threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+    // Current job
+    TaskFunction task;
+    void* context;
+    int num_items;
+    // Next item to be taken by a worker (updated atomically)
+    int next_item;
+    // Number of workers still running the current job
+    int active_workers;
+    // Incremented for every job, so the workers can tell a new job started
+    int generation;
+    bool shutdown;
+} ThreadPool;
+
+typedef struct AnalysisResult {
+    // False if the position could not be parsed
+    bool valid;
+    // True if a player already has a line (the position is not searched)
+    bool finished;
+    // False if the turn player has no valid move
+    bool has_move;
+    Move move;
+    // Score from the point of view of the turn player
+    int score;
+    // Number of states created by the search
+    long long nodes;
+} AnalysisResult;
+
+typedef struct AnalysisBatch {
+    // Input lines and results of the batch (in input order)
+    char lines[ANALYSIS_BATCH_SIZE][ANALYSIS_LINE_SIZE];
+    AnalysisResult results[ANALYSIS_BATCH_SIZE];
+    // Lines longer than the buffer (the rest of the line was discarded)
+    bool too_long[ANALYSIS_BATCH_SIZE];
+    // One board and one engine per worker
+    Board** boards;
+    Engine** engines;
+    // Each position uses this seed plus its line number, so the results
+    // do not depend on the number of threads
+    uint64_t seed;
+    // Number of lines before this batch
+    long long first_line;
+    AdjacencyMatrix* adj_matrix;
+} AnalysisBatch;
+
+// Graph of the reachable positions of a variant in compressed sparse rows
+typedef struct GameGraph {
+    int num_nodes;
+    int num_edges;
+    // Edges of each node (the last offset is the number of edges)
+    uint32_t offsets[NUM_POSITION_INDICES + 1];
+    // Node reached and encoded move of each edge
+    uint32_t targets[NUM_POSITION_INDICES * MAX_MOVES];
+    unsigned char moves[NUM_POSITION_INDICES * MAX_MOVES];
+    // Position (rank_position) and attributes of each node
+    uint16_t ranks[NUM_POSITION_INDICES];
+    unsigned char attributes[NUM_POSITION_INDICES];
+    // Node of each position (-1 if not reachable)
+    int node_of_rank[NUM_POSITION_INDICES];
+} GameGraph;
+
+// Tables of the position index of a number of pieces
+typedef struct PositionIndex {
+    int num_pieces;
+    // Sets of nodes of player 1 and sets of nodes of player 2 among the
+    // nodes left
+    int num_sets;
+    int num_free_sets;
+    int num_positions;
+    // Rank of each mask of nodes (POSITION_INDEX_INVALID without
+    // num_pieces nodes) and mask of each rank
+    unsigned char set_rank[1 << NUM_NODES];
+    unsigned short set_masks[MAX_PIECE_SETS];
+    // Same for the masks of the nodes left by player 1
+    unsigned char free_set_rank[1 << NUM_NODES];
+    unsigned short free_set_masks[MAX_PIECE_SETS];
+    // For each set of player 1, the nodes left (in order) and the position
+    // of each node on that list
+    unsigned char free_nodes[MAX_PIECE_SETS][NUM_NODES];
+    unsigned char free_slots[MAX_PIECE_SETS][NUM_NODES];
+} PositionIndex;
+
+// Retrograde solver of a variant
+typedef struct Solver {
+    const Rules* rules;
+    int variant;
+    // Numbering of the positions with all the pieces of the variant
+    PositionIndex index;
+    // Mapped file: header and the bits of the positions won and lost by the
+    // turn player
+    unsigned char* data;
+    size_t size;
+    uint64_t* wins;
+    uint64_t* losses;
+    int64_t num_words;
+    // Positions decided on the current pass
+    long long num_changes;
+} Solver;
+
+// Move of a recorded game to be reviewed
+typedef struct ReviewItem {
+    // Game (index on the batch), move number and player of the move
+    int game;
+    int ply;
+    int player;
+    // Position before the move
+    unsigned char cells[NUM_NODES];
+    // False if the move is not valid (the rest of the game is not reviewed)
+    bool legal;
+    // Scores of the move and of the best move for the player
+    int score;
+    int best_score;
+} ReviewItem;
+
+typedef struct ReviewBatch {
+    GameRecord records[REVIEW_BATCH_GAMES];
+    int num_games;
+    // One item per move of the games, in game and move order
+    ReviewItem items[REVIEW_BATCH_GAMES * MAX_RECORD_MOVES];
+    int num_items;
+    EngineConfig config;
+    // Number of games before this batch
+    long long first_game;
+    // Lines of the batch, written with a single call
+    char out[REVIEW_BATCH_GAMES * MAX_RECORD_MOVES * REVIEW_LINE_SIZE];
+    int out_length;
+} ReviewBatch;
+
+// Rules of a variant as data: the graph, the winning lines and the start
+// The nodes are the cells of the BOARD_SIZE x BOARD_SIZE grid, row by row
+// (the octagon of Shisima is drawn on the grid with its centre on the
+// centre cell), so the board is shown and the moves are recorded as in the
+// classic game
+typedef struct RulesDefinition {
+    const char* name;
+    // Pairs of nodes joined by an edge (next to each other on the grid)
+    const int (*edges)[2];
+    int num_edges;
+    const int (*lines)[BOARD_SIZE];
+    int num_lines;
+    // Line that is not a win for each player (-1 for none)
+    int home_lines[2];
+    // Start cells in position notation (without the turn player)
+    const char* start;
+    // Pieces of each player
+    int num_pieces;
+    // The pieces are dropped on empty nodes before they move
+    bool drop_phase;
+    // Node of the centre feature of the evaluation (-1 for none)
+    int center;
+} RulesDefinition;
+
+// Rules compiled into flat tables for the move generator and the search
+typedef struct Rules {
+    const char* name;
+    // Neighbors of each node in the order of list_valid_moves
+    int neighbors[NUM_NODES][MAX_MOVES];
+    int num_neighbors[NUM_NODES];
+    // Winning lines of each player
+    int lines[2][NUM_LINES][BOARD_SIZE];
+    int num_lines[2];
+    unsigned char start[NUM_NODES];
+    int num_pieces;
+    bool drop_phase;
+    int center;
+} Rules;
+
+// Directory entry of a position on the game database index
+typedef struct IndexKeyEntry {
+    // Place and size in bytes of the list of games
+    uint64_t offset;
+    uint32_t size;
+    // Number of times the position was reached
+    uint32_t num_entries;
+    // Results of the games (by winner id, id_empty for a draw)
+    uint32_t results[3];
+    uint32_t num_games;
+} IndexKeyEntry;
+
+typedef struct FastSearch {
+    const Rules* rules;
+    EngineConfig config;
+    // Player the scores are calculated for
+    int computer_id;
+    // Moves left at the root until the game ends as a draw
+    int plies_left;
+    long long nodes;
+} FastSearch;
+
+typedef struct TournamentGame {
+    // Configuration of each side
+    int configs[2];
+    // Winner id or id_empty for a draw
+    int winner;
+    // CPU time (nanoseconds) and number of moves of each side
+    uint64_t cpu_time[2];
+    long long num_moves[2];
+} TournamentGame;
+
+typedef struct Tournament {
+    EngineConfig configs[MAX_TOURNAMENT_CONFIGS];
+    // Text of each configuration (used as its name)
+    char names[MAX_TOURNAMENT_CONFIGS][TOURNAMENT_NAME_SIZE];
+    int num_configs;
+    TournamentGame* games;
+    int num_games;
+    // Engines of each worker and configuration (one array for each side)
+    Engine** engines;
+    Engine** second_engines;
+    // Each game uses this seed plus its number
+    uint64_t seed;
+} Tournament;
+
+// Shrinks the budgets of the computer moves when there are too many moves
+// waiting or the recent moves took too long, and restores them when the
+// load drops
+typedef struct EngineScheduler {
+    // Budgets without degradation
+    EngineConfig base_config;
+    // Target latency of a move (microseconds)
+    uint64_t target_latency;
+    // Moves waiting that the threads handle without overload
+    int max_queued;
+    // Moves requested and not finished
+    int queued;
+    // Moving average of the latency of the moves (microseconds)
+    double recent_latency;
+    // Active degradation level
+    int level;
+    int moves_since_change;
+    pthread_mutex_t mutex;
+    // Moves played on each level and their latency (waiting included)
+    long long level_moves[SCHEDULER_LEVELS];
+    LatencyHistogram latency;
+} EngineScheduler;
+
+// Game of the load test (the computer plays both sides)
+typedef struct LoadGame {
+    Board* board;
+    int priority;
+    bool finished;
+} LoadGame;
+
+typedef struct LoadTest {
+    EngineScheduler scheduler;
+    LoadGame* games;
+    // Games playing the current round
+    int* active;
+    AdjacencyMatrix* adj_matrix;
+    // Engine of each worker (the games share them, so trees are not reused)
+    Engine** engines;
+    // When the moves of the round were requested
+    uint64_t request_time;
+} LoadTest;
+
+// Span of a search phase
+typedef struct TraceEvent {
+    // Static string (only the pointer is stored)
+    const char* name;
+    // Nanoseconds since the start of the trace
+    uint64_t start;
+    uint64_t duration;
+    int height;
+    int value;
+} TraceEvent;
+
+// Events of one thread, so recording an event needs no lock
+typedef struct TraceBuffer {
+    TraceEvent* events;
+    int num_events;
+    int capacity;
+    long long dropped;
+    int thread_id;
+    TraceBuffer* next;
+} TraceBuffer;
+
+typedef struct Tracer {
+    bool enabled;
+    const char* path;
+    // Deepest height of the search tree with recorded spans
+    int max_height;
+    uint64_t start_time;
+    // Buffers of all threads that recorded events
+    TraceBuffer* buffers;
+    int num_threads;
+    pthread_mutex_t mutex;
+} Tracer;
+
+// Search tracing state (disabled unless --trace is given)
+Tracer tracer = {false};
+__thread TraceBuffer* thread_trace_buffer = NULL;
+
+// Records of one thread, written to the file when full
+typedef struct TreeDumpBuffer {
+    unsigned char data[TREE_DUMP_BUFFER_SIZE];
+    int used;
+    TreeDumpBuffer* next;
+} TreeDumpBuffer;
+
+typedef struct TreeDump {
+    bool enabled;
+    FILE* file;
+    // Number of the last node (the nodes of all searches are numbered
+    // from 1)
+    int last_id;
+    long long num_nodes;
+    bool failed;
+    // Buffers of all threads that dumped nodes
+    TreeDumpBuffer* buffers;
+    pthread_mutex_t mutex;
+} TreeDump;
+
+// Node of a tree dump read back for the DOT conversion
+typedef struct TreeDumpNode {
+    int id;
+    int parent;
+    int score;
+    unsigned char move;
+    unsigned char height;
+    unsigned char reason;
+    bool shown;
+} TreeDumpNode;
+
+// Search tree dump state (disabled unless --dump-tree is given)
+TreeDump tree_dump = {false};
+__thread TreeDumpBuffer* thread_tree_dump_buffer = NULL;
+// Why calculate_state_score stopped at the last node it returned
+__thread CutoffReason thread_cutoff_reason = cutoff_none;
+
+// Memory of the engine by category (the last one is the total) and of the
+// calling thread
+// The counters by category are shared by all the threads, so they are kept
+// only when they are shown (--stats)
+bool memory_accounting = false;
+MemoryAccount memory_accounts[NUM_MEMORY_CATEGORIES + 1];
+const char* MEMORY_CATEGORY_NAMES[NUM_MEMORY_CATEGORIES + 1] = {
+    "tabuleiros", 
+    "arvore de busca", 
+    "jogadas", 
+    "listas de jogadas", 
+    "busca pn", 
+    "computadores", 
+    "total"
+};
+__thread long long thread_memory_bytes = 0;
+__thread long long thread_memory_peak = 0;
+__thread long long thread_memory_allocations = 0;
+
+// Edges of the board: the border of the square (the octagon of Shisima)
+// and the lines from the centre to every other node
+const int BOARD_EDGES[16][2] = {
+    {0, 1}, {1, 2}, {2, 5}, {5, 8}, {8, 7}, {7, 6}, {6, 3}, {3, 0},
+    {4, 0}, {4, 1}, {4, 2}, {4, 3}, {4, 5}, {4, 6}, {4, 7}, {4, 8}
+};
+
+// Shisima is won only on the lines through the centre
+const int SHISIMA_LINES[4][BOARD_SIZE] = {
+    {3, 4, 5}, {1, 4, 7}, {0, 4, 8}, {2, 4, 6}
+};
+
+// Rules of each variant (indexed by the variant identifiers)
+const RulesDefinition VARIANT_DEFINITIONS[NUM_VARIANTS] = {
+    // Pe de galinha: the initial row of each player is not a win
+    {"classic", BOARD_EDGES, 16, BOARD_LINES, NUM_LINES, {2, 0}, 
+        "OOO+++XXX", NUM_PIECES, false, 4},
+    {"shisima", BOARD_EDGES, 16, SHISIMA_LINES, 4, {-1, -1}, 
+        "OOO+++XXX", NUM_PIECES, false, 4},
+    // Tapatan and Achi start with an empty board and drop the pieces
+    {"tapatan", BOARD_EDGES, 16, BOARD_LINES, NUM_LINES, {-1, -1}, 
+        "+++++++++", 3, true, 4},
+    {"achi", BOARD_EDGES, 16, BOARD_LINES, NUM_LINES, {-1, -1}, 
+        "+++++++++", 4, true, 4}
+};
+
+// Compiled rules of each variant (filled by compile_all_rules)
+Rules variant_rules[NUM_VARIANTS];
+
+// Tables of the position index of NUM_PIECES pieces (filled by
+// init_position_index)
+PositionIndex position_index;
+
 
 // Function prototypes
 // Explanations are in the function definitions below
@@ -97,6 +1183,38 @@ typedef struct BoardState {
 // Auxiliary functions
 int min(int a, int b);
 int max(int a, int b);
+long long max_long(long long a, long long b);
+
+// Random number generator functions
+void seed_rng(Rng* rng, uint64_t seed);
+uint64_t next_random(Rng* rng);
+uint64_t random_below(Rng* rng, uint64_t limit);
+
+// Engine functions
+void init_engine_config(EngineConfig* config);
+Engine* create_engine(uint64_t seed, EngineConfig* config);
+void seed_engine(Engine* engine, uint64_t seed);
+void clear_engine_tree(Engine* engine);
+void delete_engine(Engine* engine);
+int find_move_number(
+    Board* board, 
+    Move move, 
+    AdjacencyMatrix* adj_matrix
+);
+void keep_search_tree(
+    Engine* engine,
+    BoardState* root,
+    Board* board,
+    Move* move,
+    int computer_id,
+    AdjacencyMatrix* adj_matrix
+);
+BoardState* take_reusable_subtree(
+    Engine* engine,
+    Board* board,
+    int computer_id,
+    AdjacencyMatrix* adj_matrix
+);
 
 // Position functions
 bool positions_are_equal(Position pos_a, Position pos_b);
@@ -113,6 +1231,7 @@ void delete_adjacency_matrix(AdjacencyMatrix* adj_matrix);
 int size_of_board_struct();
 bool board_position_valid(Board* board, Position pos);
 Board* create_board();
+void set_initial_position(Board* board);
 void delete_board(Board* board);
 void copy_board(Board* board, Board* copy);
 bool connected(
@@ -124,15 +1243,20 @@ int get_player(Position pos, Board* board);
 void set_player(Position pos, int player, Board* board);
 char get_player_from_symbol(char symbol);
 char get_symbol_from_player(int player);
-void print_board(Board* board);
-
-// Move functions
-bool is_valid_move(
+void print_board(Board* board, BoardRenderer* renderer);
+int render_board(Board* board, char* out);
+int render_board_changes(
     Board* board, 
-    Move move, 
-    AdjacencyMatrix* adj_matrix,
-    bool print_error
+    BoardRenderer* renderer, 
+    char* out
 );
+void init_board_renderer(BoardRenderer* renderer, RenderMode mode);
+void reset_board_renderer(BoardRenderer* renderer);
+
+// Move functions
+MoveError get_move_error(Board* board, Move move, AdjacencyMatrix* adj_matrix);
+bool is_valid_move(Board* board, Move move, AdjacencyMatrix* adj_matrix);
+const char* get_move_error_message(MoveError error);
 void add_move_if_valid(
     Move** valid_moves, 
     int* move_count, 
@@ -155,18 +1279,14 @@ void list_valid_moves(
     AdjacencyMatrix* adj_matrix
 );
 Move* get_computer_move(
+    Engine* engine,
     Board* board,
     int player_id,
     int computer_id,
     AdjacencyMatrix* adj_matrix
 );
 Move* get_player_move(int player);
-void make_move(
-    Board* board, 
-    Move move, bool* 
-    move_player, 
-    AdjacencyMatrix* adj_matrix
-);
+MoveError make_move(Board* board, Move move, AdjacencyMatrix* adj_matrix);
 
 
 // Board state functions
@@ -180,34 +1300,65 @@ Move* get_winning_move(
     Move** moves, 
     int num_moves
 );
+BoardState* get_cached_child(BoardState* cache, int move_number);
+int shift_cached_score(int score, int height_difference);
+void rescale_cached_scores(BoardState* state, int max_height_difference);
+void order_moves_by_cache(
+    BoardState* cache, 
+    int num_moves, 
+    bool maximize, 
+    int* order
+);
 int calculate_state_score(
     BoardState* state, 
+    BoardState* cache,
     Board* board, 
     int player, 
     int computer_player,
+    EngineConfig* config,
     AdjacencyMatrix* adj_matrix
 );
 void calculate_root_children_score(
     BoardState* root,
+    BoardState* cache,
     Board* board,
     int player_id,
     int computer_id,
+    EngineConfig* config,
     Move** moves,
     int num_moves,
     AdjacencyMatrix* adj_matrix
 );
+int get_highest_score_position(int* scores, int num_scores, Rng* rng);
 int get_move_with_highest_score_position(
     BoardState** children, 
     int num_children, 
-    int computer_id
+    int computer_id,
+    Rng* rng
 );
 Move* get_best_move(
+    Engine* engine,
     BoardState* root, 
+    BoardState* cache,
     Board* board,
     int player_id, 
     int computer_id,
     AdjacencyMatrix* adj_matrix
 );
+Move* get_best_move_within_budget(
+    Engine* engine,
+    BoardState** root, 
+    BoardState* cache,
+    Board* board, 
+    int player_id, 
+    int computer_id,
+    AdjacencyMatrix* adj_matrix
+);
+Move* get_proven_move(
+    Engine* engine, 
+    Board* board, 
+    AdjacencyMatrix* adj_matrix
+);
 
 // Game functions
 bool win_by_row(Board* board, int row);
@@ -218,17 +1369,478 @@ bool is_winner_by_rows(Board* board);
 bool is_winner_by_columns(Board* board);
 bool is_winner_by_diagonals(Board* board);
 bool player_is_winner(Board* board);
-void play_user_turn(Board* board, AdjacencyMatrix* adj_matrix);
-void play_computer_turn(
-    Board* board, 
-    int player_id, 
-    int computer_id,
-    AdjacencyMatrix* adj_matrix
+void init_game(Game* game, GameMode mode, uint64_t seed, Engine* engine);
+void delete_game(Game* game);
+int get_computer_player(GameMode mode);
+void update_game_status(Game* game);
+GameStatus get_game_status(Game* game);
+void end_game_turn(Game* game, Move move);
+MoveError submit_move(Game* game, Move move);
+bool step_game(Game* game);
+void play_user_turn(Game* game);
+void play_computer_turn(Game* game);
+void checkpoint_game(Game* game, GameSettings* settings);
+void play_game(Game* game, GameSettings* settings);
+void player_vs_player(GameSettings* settings);
+void player_vs_computer(bool player_starts, GameSettings* settings);
+int play_computer_game(
+    Engine** engines, 
+    GameRecord* record, 
+    SpectatorFeed* spectators
 );
-void player_vs_player();
-void player_vs_computer(bool player_starts);
+void self_play(int num_games, GameSettings* settings);
 void print_menu();
 int get_menu_option();
+void run_menu(GameSettings* settings);
+void print_usage(const char* program);
+
+// Game snapshot functions
+void store_little_endian(unsigned char* out, uint64_t value, int num_bytes);
+uint64_t load_little_endian(const unsigned char* in, int num_bytes);
+void snapshot_game(Game* game, unsigned char* out);
+bool is_valid_game_snapshot(const unsigned char* in);
+bool restore_game(Game* game, const unsigned char* in, Engine* engine);
+bool save_live_games(
+    const char* path, 
+    const unsigned char* current, 
+    const unsigned char* waiting, 
+    int num_waiting
+);
+unsigned char* load_game_snapshots(const char* path, int* num_snapshots);
+bool resume_games(const char* path, GameSettings* settings);
+
+// Spectator functions
+SpectatorFeed* create_spectator_feed(
+    int num_spectators, 
+    int num_threads, 
+    FILE* output
+);
+void publish_spectator_event(
+    SpectatorFeed* feed, 
+    SpectatorEventType type, 
+    Board* board, 
+    int move
+);
+const SpectatorEvent* read_spectator_event(Spectator* spectator);
+bool finish_spectator_event(
+    Spectator* spectator, 
+    const SpectatorEvent* event
+);
+uint64_t wait_spectator_events(SpectatorFeed* feed, uint64_t last_read);
+void* run_spectators(void* arg);
+void close_spectator_feed(SpectatorFeed* feed);
+
+// Rules functions
+int find_variant(const char* name);
+bool compile_rules(const RulesDefinition* definition, Rules* rules);
+void compile_all_rules();
+bool rules_have_line(const Rules* rules, unsigned char* cells, int player);
+int get_rules_line_distance(
+    const Rules* rules, 
+    unsigned char* cells, 
+    int player
+);
+void apply_encoded_move(unsigned char* cells, int move, int player);
+void undo_encoded_move(unsigned char* cells, int move, int player);
+int list_rules_moves(
+    const Rules* rules, 
+    unsigned char* cells, 
+    int player, 
+    unsigned char* moves
+);
+int play_variant_game(const Rules* rules, Engine** engines, GameRecord* record);
+
+// Position index functions
+void init_position_index(PositionIndex* index, int num_pieces);
+int rank_indexed_position(
+    const PositionIndex* index, 
+    unsigned char* cells, 
+    int turn_player
+);
+void unrank_indexed_position(
+    const PositionIndex* index, 
+    int rank, 
+    unsigned char* cells, 
+    int* turn_player
+);
+int rank_position(unsigned char* cells, int turn_player);
+void unrank_position(int rank, unsigned char* cells, int* turn_player);
+
+// Fast search functions
+void init_fast_search(
+    FastSearch* search, 
+    EngineConfig* config, 
+    const Rules* rules, 
+    int plies_left
+);
+void get_board_cells(Board* board, unsigned char* cells);
+int fast_evaluate(FastSearch* search, unsigned char* cells, int player);
+int fast_state_score(
+    FastSearch* search, 
+    unsigned char* cells, 
+    int turn_player, 
+    int height
+);
+int fast_root_scores(
+    FastSearch* search, 
+    unsigned char* cells, 
+    int computer_id, 
+    int* scores
+);
+int select_fast_move(
+    Engine* engine, 
+    const Rules* rules, 
+    unsigned char* cells, 
+    int player, 
+    int plies_left
+);
+Move* get_fast_move(Engine* engine, Board* board);
+int get_reference_root_scores(
+    Board* board, 
+    EngineConfig* config, 
+    AdjacencyMatrix* adj_matrix, 
+    int* scores
+);
+int compare_root_scores(
+    Board* board, 
+    EngineConfig* config, 
+    AdjacencyMatrix* adj_matrix, 
+    int* reference_scores, 
+    int* fast_scores
+);
+int play_random_walk(
+    Board* board, 
+    int num_moves, 
+    Rng* rng, 
+    AdjacencyMatrix* adj_matrix, 
+    unsigned char* walk
+);
+int verify_fast_search(
+    int num_positions, 
+    uint64_t seed, 
+    EngineConfig* config
+);
+
+// Evaluation functions
+bool is_home_line(int line, int player);
+int get_line_distance(Board* board, int player);
+bool is_turn_limit_draw(int turn_distance, int other_distance, int plies_left);
+int count_valid_moves(Board* board, int player, AdjacencyMatrix* adj_matrix);
+void get_evaluation_features(
+    Board* board, 
+    int player, 
+    AdjacencyMatrix* adj_matrix, 
+    int* features
+);
+void get_feature_differences(
+    Board* board, 
+    int player, 
+    AdjacencyMatrix* adj_matrix, 
+    int* differences
+);
+int evaluate_board(
+    Board* board, 
+    int player, 
+    int* weights, 
+    AdjacencyMatrix* adj_matrix
+);
+bool parse_eval_weights(const char* text, int* weights);
+int get_tuning_cell(int* differences);
+bool tune_eval_weights(const char* path, int* weights);
+
+// Proof-number search functions
+bool cells_have_line(unsigned char* cells, int player);
+int get_proof_entry(unsigned char* cells, int turn_player, int plies_left);
+ProofSearch* create_proof_search(
+    int max_nodes, 
+    AdjacencyMatrix* adj_matrix
+);
+void delete_proof_search(ProofSearch* search);
+int add_proof_node(
+    ProofSearch* search, 
+    int parent, 
+    unsigned char* cells, 
+    int turn_player, 
+    int plies_left, 
+    int move
+);
+uint32_t add_proof_numbers(uint32_t a, uint32_t b);
+bool expand_proof_node(ProofSearch* search, int index);
+void update_proof_node(ProofSearch* search, int index);
+int select_most_proving_node(ProofSearch* search);
+int get_proof_table_length(
+    ProofSearch* search, 
+    unsigned char* cells, 
+    int turn_player, 
+    int plies_left
+);
+void follow_proof_table(
+    ProofSearch* search, 
+    unsigned char* position, 
+    int turn_player, 
+    int plies_left, 
+    int length, 
+    ProofResult* result
+);
+void prove_position(
+    Board* board, 
+    int plies_left, 
+    int max_nodes, 
+    AdjacencyMatrix* adj_matrix, 
+    ProofResult* result
+);
+void print_proof(const char* notation, int plies_left, int max_nodes);
+
+// Latency statistics functions
+uint64_t get_time_microseconds();
+uint64_t get_thread_cpu_time();
+int get_latency_bucket(uint64_t value);
+uint64_t get_latency_bucket_value(int bucket);
+void record_latency(LatencyHistogram* histogram, uint64_t value);
+void merge_latency_histogram(
+    LatencyHistogram* histogram, 
+    LatencyHistogram* other
+);
+uint64_t get_latency_percentile(LatencyHistogram* histogram, double fraction);
+int get_game_phase(int ply);
+void print_latency_line(const char* label, LatencyHistogram* histogram);
+void print_latency_stats(Engine** engines, int num_engines);
+
+// Memory accounting functions
+void add_memory_usage(MemoryCategory category, long long bytes, bool shared);
+void* malloc_tracked(size_t size, MemoryCategory category);
+void* calloc_tracked(size_t count, size_t size, MemoryCategory category);
+void free_tracked(void* block);
+void begin_memory_window(MemoryWindow* window);
+void end_memory_window(MemoryWindow* window, Engine* engine);
+void print_memory_stats(Engine** engines, int num_engines);
+
+// Trace functions
+uint64_t get_time_nanoseconds();
+void start_trace(const char* path, int max_height);
+TraceBuffer* get_trace_buffer();
+uint64_t begin_trace_span(int height);
+void end_trace_span(
+    const char* name, 
+    uint64_t start_time, 
+    int height, 
+    int value
+);
+bool write_trace();
+
+// Tree dump functions
+bool start_tree_dump(const char* path);
+int get_tree_dump_id();
+void write_tree_dump_node(
+    int id, 
+    int parent, 
+    int move, 
+    int height, 
+    int score, 
+    CutoffReason reason
+);
+void flush_tree_dump_buffer(TreeDumpBuffer* buffer);
+bool finish_tree_dump();
+const char* get_cutoff_reason_name(CutoffReason reason);
+TreeDumpNode* read_tree_dump(
+    const char* path, 
+    int max_height, 
+    int* num_nodes
+);
+int compare_tree_dump_ids(const void* a, const void* b);
+int compare_tree_dump_siblings(const void* a, const void* b);
+int compare_tree_dump_heights(const void* a, const void* b);
+int find_tree_dump_node(TreeDumpNode* nodes, int num_nodes, int id);
+bool convert_tree_dump_to_dot(
+    const char* path, 
+    FILE* output, 
+    int top, 
+    int max_height
+);
+
+// Game record functions
+unsigned char encode_move(Move move);
+Move decode_move(unsigned char code);
+void init_game_record(GameRecord* record, int variant, uint64_t seed);
+void add_move_to_record(GameRecord* record, Move move);
+GameRecordWriter* open_record_writer(const char* path);
+void flush_record_writer(GameRecordWriter* writer);
+void write_game_record(GameRecordWriter* writer, GameRecord* record);
+void close_record_writer(GameRecordWriter* writer);
+GameRecordReader* open_record_reader(const char* path);
+bool fill_record_reader(GameRecordReader* reader, int needed);
+bool read_game_record(GameRecordReader* reader, GameRecord* record);
+void close_record_reader(GameRecordReader* reader);
+void print_records_summary(const char* path);
+
+// Game database functions
+int get_game_position_ranks(GameRecord* record, int* ranks);
+int write_varint(unsigned char* out, uint64_t value);
+int read_varint(
+    const unsigned char* in, 
+    const unsigned char* end, 
+    uint64_t* value
+);
+bool index_game(
+    IndexKeyEntry* directory, 
+    int64_t* last_game, 
+    uint64_t* cursors, 
+    unsigned char* data, 
+    GameRecord* record, 
+    int64_t game
+);
+void write_index_key_entry(unsigned char* out, IndexKeyEntry* key);
+void read_index_key_entry(const unsigned char* in, IndexKeyEntry* key);
+bool build_game_index(const char* path);
+bool query_game_index(const char* index_path, const char* notation);
+
+// Position notation functions
+bool parse_position_notation(const char* text, Board* board);
+int format_position_notation(Board* board, char* out);
+
+// Thread pool functions
+int get_number_of_cores();
+ThreadPool* create_thread_pool(int num_threads);
+void* thread_pool_worker_loop(void* arg);
+void thread_pool_run(
+    ThreadPool* pool, 
+    TaskFunction task, 
+    void* context, 
+    int num_items
+);
+void delete_thread_pool(ThreadPool* pool);
+
+// Analysis functions
+long long count_board_states(BoardState* state);
+void analyze_position(
+    Engine* engine,
+    Board* board, 
+    AdjacencyMatrix* adj_matrix, 
+    AnalysisResult* result
+);
+void analyze_batch_item(void* context, int item, int worker);
+int append_int(char* out, long long value);
+int format_analysis_result(
+    const char* line, 
+    AnalysisResult* result, 
+    char* out
+);
+void analyze_positions(
+    FILE* input, 
+    FILE* output, 
+    int num_threads, 
+    uint64_t seed,
+    EngineConfig* config
+);
+
+// Review functions
+int get_review_scores(
+    const Rules* rules, 
+    EngineConfig* config, 
+    unsigned char* cells, 
+    int player, 
+    int plies_left, 
+    unsigned char* moves, 
+    int* scores
+);
+void review_batch_item(void* context, int item, int worker);
+void prepare_review_batch(ReviewBatch* batch);
+int format_review_item(
+    ReviewBatch* batch, 
+    ReviewItem* review, 
+    long long* counts
+);
+bool review_games(
+    const char* path, 
+    FILE* output, 
+    int num_threads, 
+    EngineConfig* config
+);
+
+// Game graph functions
+bool build_game_graph(const Rules* rules, GameGraph* graph);
+bool write_game_graph(const char* path, GameGraph* graph, int variant);
+bool export_game_graph(const char* path, int variant);
+
+// Solver functions
+bool get_solver_bit(const uint64_t* bits, int64_t rank);
+void set_solver_bit(uint64_t* bits, int64_t rank);
+bool open_solver_file(Solver* solver, const char* path);
+void solve_piece_set(void* context, int item, int worker);
+int get_solver_value(Solver* solver, unsigned char* cells, int turn_player);
+int get_solver_drop_value(
+    Solver* solver, 
+    unsigned char* cells, 
+    int turn_player
+);
+bool solve_variant(const char* path, int variant, int num_threads);
+
+// Script replay functions
+char* load_script(const char* path, size_t* size, bool* mapped);
+int scan_int(const char** cursor, const char* end, int* value);
+void replay_game_line(
+    const char* line,
+    const char* end,
+    Board* board,
+    AdjacencyMatrix* adj_matrix,
+    ReplayResult* result
+);
+int format_replay_result(
+    int game_number, 
+    Board* board, 
+    ReplayResult* result, 
+    char* out
+);
+int replay_script(const char* path);
+
+// Tournament functions
+bool parse_engine_config(const char* text, EngineConfig* config);
+void play_tournament_game(void* context, int item, int worker);
+double get_elo_difference(double score);
+void get_elo_estimate(
+    int wins, 
+    int draws, 
+    int losses, 
+    double* elo, 
+    double* margin
+);
+bool run_tournament(
+    const char* configs_text, 
+    int games_per_colour, 
+    int num_threads, 
+    uint64_t seed, 
+    EngineConfig* base_config
+);
+
+// Scheduler functions
+void init_engine_scheduler(
+    EngineScheduler* scheduler, 
+    EngineConfig* config, 
+    uint64_t target_latency, 
+    int num_threads
+);
+void destroy_engine_scheduler(EngineScheduler* scheduler);
+void request_scheduled_moves(EngineScheduler* scheduler, int num_moves);
+int get_degradation_level(EngineScheduler* scheduler);
+int get_game_degradation_level(EngineScheduler* scheduler, int priority);
+void get_degraded_config(
+    EngineConfig* base_config, 
+    int level, 
+    EngineConfig* config
+);
+void finish_scheduled_move(
+    EngineScheduler* scheduler, 
+    int level, 
+    uint64_t latency
+);
+void play_load_move(void* context, int item, int worker);
+void run_load_test(
+    int num_games, 
+    int num_threads, 
+    uint64_t seed, 
+    EngineConfig* config, 
+    uint64_t target_latency
+);
 
 
 // **********
@@ -239,6 +1851,248 @@ int min(int a, int b) {
 int max(int a, int b) {
     return (a > b) ? a : b;
 }
+long long max_long(long long a, long long b) {
+    return (a > b) ? a : b;
+}
+
+
+// **********
+// Random number generator functions
+
+// Seed the generator (the state is filled with splitmix64)
+void seed_rng(Rng* rng, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        seed += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        rng->state[i] = z ^ (z >> 31);
+    }
+    return;
+}
+
+
+// Get the next 64 random bits (xoshiro256**)
+uint64_t next_random(Rng* rng) {
+    uint64_t* s = rng->state;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+
+    return result;
+}
+
+
+// Get a uniform random number in [0, limit)
+uint64_t random_below(Rng* rng, uint64_t limit) {
+    // Discard the values of the last incomplete range to avoid bias
+    uint64_t threshold = -limit % limit;
+    uint64_t value = next_random(rng);
+    while (value < threshold) {
+        value = next_random(rng);
+    }
+    return value % limit;
+}
+
+
+// **********
+// Engine functions
+
+// Set the default engine settings
+void init_engine_config(EngineConfig* config) {
+    config->type = engine_minimax;
+    config->reuse_tree = true;
+    config->max_height = MAX_TREE_HEIGHT;
+    config->use_evaluation = true;
+    config->max_nodes = 0;
+    config->eval_weights[feature_mobility] = 1;
+    config->eval_weights[feature_center] = 2;
+    config->eval_weights[feature_threats] = 3;
+    config->eval_weights[feature_line_distance] = 2;
+    return;
+}
+
+
+// Create a computer player with its own random number generator
+Engine* create_engine(uint64_t seed, EngineConfig* config) {
+    Engine* engine = (Engine*) malloc_tracked(sizeof(Engine), memory_engines);
+    engine->config = *config;
+    engine->tree = NULL;
+    engine->played_state = NULL;
+    engine->tree_max_height = config->max_height;
+    memset(engine->move_latency, 0, sizeof(engine->move_latency));
+    engine->cpu_time = 0;
+    engine->num_moves = 0;
+    memset(&(engine->move_memory), 0, sizeof(engine->move_memory));
+    memset(&(engine->move_allocations), 0, sizeof(engine->move_allocations));
+    seed_engine(engine, seed);
+    return engine;
+}
+
+
+// Restart the engine for a new game
+// The random number generator is seeded and the last search is forgotten
+void seed_engine(Engine* engine, uint64_t seed) {
+    seed_rng(&(engine->rng), seed);
+    clear_engine_tree(engine);
+    return;
+}
+
+
+// Free the tree kept from the last search
+void clear_engine_tree(Engine* engine) {
+    if (engine->tree != NULL) {
+        delete_board_state(engine->tree);
+    }
+    engine->tree = NULL;
+    engine->played_state = NULL;
+    return;
+}
+
+
+// Free the engine
+void delete_engine(Engine* engine) {
+    clear_engine_tree(engine);
+    free_tracked(engine);
+    return;
+}
+
+
+// Get the number (index) of the move in the list_valid_moves order
+// Returns -1 if the move is not valid for the turn player
+int find_move_number(
+    Board* board, 
+    Move move, 
+    AdjacencyMatrix* adj_matrix
+) {
+    Move* moves[MAX_MOVES];
+    int num_moves = 0;
+    list_valid_moves(board, moves, &num_moves, adj_matrix);
+
+    int move_number = -1;
+    for (int i = 0; i < num_moves; i++) {
+        if (positions_are_equal(moves[i]->origin, move.origin) 
+            && positions_are_equal(moves[i]->destiny, move.destiny)) {
+            move_number = i;
+        }
+        free_tracked(moves[i]);
+    }
+    return move_number;
+}
+
+
+// Keep the tree of the search for the next turn
+// Only the subtree of the chosen move is useful later, the rest is kept
+// until the next search to avoid freeing it while the game waits
+void keep_search_tree(
+    Engine* engine,
+    BoardState* root,
+    Board* board,
+    Move* move,
+    int computer_id,
+    AdjacencyMatrix* adj_matrix
+) {
+    clear_engine_tree(engine);
+
+    // Find the state of the chosen move
+    // (there is none if the move wins the game)
+    int move_number = find_move_number(board, *move, adj_matrix);
+    BoardState* played_state = get_cached_child(root, move_number);
+    if (played_state == NULL) {
+        delete_board_state(root);
+        return;
+    }
+
+    engine->tree = root;
+    engine->played_state = played_state;
+    engine->computer_id = computer_id;
+
+    // Store the cells after the move
+    for (int node = 0; node < NUM_NODES; node++) {
+        engine->played_cells[node] = (
+            board->table[node / board->size][node % board->size]
+        );
+    }
+    int origin = convert_position_to_node(move->origin, board->size);
+    int destiny = convert_position_to_node(move->destiny, board->size);
+    engine->played_cells[destiny] = engine->played_cells[origin];
+    engine->played_cells[origin] = id_empty;
+    return;
+}
+
+
+// Take the subtree of the last search that matches the current board
+// After the opponent's reply, the matching grandchild of the last root is
+// the new root. The rest of the old tree is freed.
+// Returns NULL if there is no matching subtree
+BoardState* take_reusable_subtree(
+    Engine* engine,
+    Board* board,
+    int computer_id,
+    AdjacencyMatrix* adj_matrix
+) {
+    if (engine->tree == NULL) {
+        return NULL;
+    }
+
+    BoardState* subtree = NULL;
+    int opponent_id = (computer_id == id_player_1) ? id_player_2 : id_player_1;
+
+    // Find the opponent's move: one of their pieces left a cell and one
+    // empty cell got their piece. Everything else must be the same
+    int origin = -1;
+    int destiny = -1;
+    bool same_game = (engine->computer_id == computer_id);
+    for (int node = 0; node < NUM_NODES && same_game; node++) {
+        int before = engine->played_cells[node];
+        int now = board->table[node / board->size][node % board->size];
+        if (before == now) {
+            continue;
+        }
+        if (before == opponent_id && now == id_empty && origin == -1) {
+            origin = node;
+        } else if (before == id_empty && now == opponent_id && destiny == -1) {
+            destiny = node;
+        } else {
+            same_game = false;
+        }
+    }
+
+    if (same_game && origin != -1 && destiny != -1) {
+        Move reply;
+        reply.origin.row = origin / board->size;
+        reply.origin.col = origin % board->size;
+        reply.destiny.row = destiny / board->size;
+        reply.destiny.col = destiny % board->size;
+
+        // Undo the reply to find its number in the opponent's move list
+        int turn_player = board->turn_player;
+        set_player(reply.origin, opponent_id, board);
+        set_player(reply.destiny, id_empty, board);
+        board->turn_player = opponent_id;
+        int move_number = find_move_number(board, reply, adj_matrix);
+        board->turn_player = turn_player;
+        set_player(reply.destiny, opponent_id, board);
+        set_player(reply.origin, id_empty, board);
+
+        // Detach the grandchild from the old tree
+        subtree = get_cached_child(engine->played_state, move_number);
+        if (subtree != NULL) {
+            engine->played_state->children[subtree->child_number] = NULL;
+            subtree->parent = NULL;
+        }
+    }
+
+    clear_engine_tree(engine);
+    return subtree;
+}
 
 
 // **********
@@ -269,7 +2123,7 @@ int convert_position_to_node(
 
 // Calculate the size of the adjacency matrix
 int size_of_adjacency_matrix() {
-    return sizeof(bool**) + sizeof(int);
+    return sizeof(AdjacencyMatrix);
 }
 
 
@@ -349,14 +2203,23 @@ void set_neigborhood(AdjacencyMatrix* adj_matrix) {
 AdjacencyMatrix* create_adjacency_matrix(int size) {
     // Allocate memory for the structure
     AdjacencyMatrix* adj_matrix = (
-        (AdjacencyMatrix*) malloc(size_of_adjacency_matrix())
+        (AdjacencyMatrix*) malloc_tracked(
+            size_of_adjacency_matrix(), 
+            memory_boards
+        )
     );
     adj_matrix->size = size;
     
     // Allocate memory for the matrix
-    adj_matrix->matrix = (bool**) malloc(size * sizeof(bool*));
+    adj_matrix->matrix = (bool**) malloc_tracked(
+        size * sizeof(bool*), 
+        memory_boards
+    );
     for (int i = 0; i < size; i++) {
-        adj_matrix->matrix[i] = (bool*) malloc(size * sizeof(bool));
+        adj_matrix->matrix[i] = (bool*) malloc_tracked(
+            size * sizeof(bool), 
+            memory_boards
+        );
         for (int j = 0; j < size; j++) {
             // Initialize the adjacency matrix with the neighborhood values
             adj_matrix->matrix[i][j] = false;
@@ -375,11 +2238,11 @@ AdjacencyMatrix* create_adjacency_matrix(int size) {
 void delete_adjacency_matrix(AdjacencyMatrix* adj_matrix) {
     // Free each row of the matrix
     for (int i = 0; i < adj_matrix->size; i++) {
-        free(adj_matrix->matrix[i]);
+        free_tracked(adj_matrix->matrix[i]);
     }
-    free(adj_matrix->matrix);
+    free_tracked(adj_matrix->matrix);
     // Free the adjacency matrix structure
-    free(adj_matrix);
+    free_tracked(adj_matrix);
     return;
 }
 
@@ -389,11 +2252,7 @@ void delete_adjacency_matrix(AdjacencyMatrix* adj_matrix) {
 
 // Return the size of the board struct in bytes
 int size_of_board_struct() {
-    // integers: size, num_pieces, turn_player
-    // pointers: adj_matrix, state
-    return (
-        sizeof(int) * 4 + sizeof(int**) 
-    );
+    return sizeof(Board);
 }
 
 
@@ -415,7 +2274,10 @@ bool board_position_valid(Board* board, Position pos) {
 // Initialize a new board
 Board* create_board() {
     // Allocate memory for the board struct
-    Board* board = (Board*) malloc(size_of_board_struct());
+    Board* board = (Board*) malloc_tracked(
+        size_of_board_struct(), 
+        memory_boards
+    );
 
     // Define the turn player as an invalid value
     board->turn_player = id_empty;
@@ -427,20 +2289,19 @@ Board* create_board() {
     board->winner = id_empty;
 
     // Allocate memory for the board state
-    board->table = (int**)malloc(board->size * sizeof(int*));
+    board->table = (int**) malloc_tracked(
+        board->size * sizeof(int*), 
+        memory_boards
+    );
     for (int i = 0; i < board->size; i++) {
-        board->table[i] = (int*)malloc(board->size * sizeof(int));
-        for (int j = 0; j < board->size; j++) {
-            // Initialize as empty values
-            board->table[i][j] = id_empty;
-        }
+        board->table[i] = (int*) malloc_tracked(
+            board->size * sizeof(int), 
+            memory_boards
+        );
     }
 
     // Set the board pices at the initial positions
-    for (int i = 0; i < board->num_pieces; i++) {
-        board->table[0][i] = id_player_2;
-        board->table[board->size-1][i] = id_player_1;
-    }
+    set_initial_position(board);
 
     // Create the adjacency matrix
     // board->adj_matrix = create_adjacency_matrix(NUM_NODES);
@@ -449,20 +2310,39 @@ Board* create_board() {
 }
 
 
-// Free the allocated memory for the board struct
-void delete_board(Board* board) {
-    // Free the allocated memory for the board state
+// Set the pieces at the initial positions, without turn player or winner
+void set_initial_position(Board* board) {
     for (int i = 0; i < board->size; i++) {
-        free(board->table[i]);
+        for (int j = 0; j < board->size; j++) {
+            // Initialize as empty values
+            board->table[i][j] = id_empty;
+        }
     }
-    free(board->table);
-    
-    // Free the allocated memory for the adjacency matrix
-    // delete_adjacency_matrix(board->adj_matrix);
-
-    
-    free(board);
-    board = NULL;
+    for (int i = 0; i < board->num_pieces; i++) {
+        board->table[0][i] = id_player_2;
+        board->table[board->size-1][i] = id_player_1;
+    }
+    board->turn_player = id_empty;
+    board->winner = id_empty;
+    board->ply = 0;
+    return;
+}
+
+
+// Free the allocated memory for the board struct
+void delete_board(Board* board) {
+    // Free the allocated memory for the board state
+    for (int i = 0; i < board->size; i++) {
+        free_tracked(board->table[i]);
+    }
+    free_tracked(board->table);
+    
+    // Free the allocated memory for the adjacency matrix
+    // delete_adjacency_matrix(board->adj_matrix);
+
+    
+    free_tracked(board);
+    board = NULL;
     return;
 }
 
@@ -529,7 +2409,55 @@ char get_symbol_from_player(int player) {
 
 
 // Print the board state
-void print_board(Board* board) {
+// The frame is built on the renderer buffer and written with a single call
+// If the renderer is NULL, the whole board is printed
+void print_board(Board* board, BoardRenderer* renderer) {
+    if (renderer == NULL) {
+        char buffer[RENDER_BUFFER_SIZE];
+        int length = render_board(board, buffer);
+        fwrite(buffer, 1, length, stdout);
+        return;
+    }
+
+    int length = 0;
+    if (renderer->mode == render_quiet) {
+        // Nothing is shown on quiet mode
+        return;
+    } else if (renderer->mode == render_full || !renderer->has_frame) {
+        if (renderer->mode == render_diff) {
+            // Clear the screen, draw the board on the top and keep the
+            // text scrolling below it
+            length += sprintf(renderer->buffer, "\x1b[2J\x1b[H");
+            length += render_board(board, renderer->buffer + length);
+            length += sprintf(
+                renderer->buffer + length, 
+                "\x1b[%d;r\x1b[%d;1H", 
+                RENDER_FRAME_LINES + 1, 
+                RENDER_FRAME_LINES + 1
+            );
+        } else {
+            length += render_board(board, renderer->buffer);
+        }
+    } else {
+        length += render_board_changes(board, renderer, renderer->buffer);
+    }
+
+    // Keep the cells of the frame to find the changes on the next one
+    for (int node = 0; node < NUM_NODES; node++) {
+        renderer->last_cells[node] = (
+            board->table[node / board->size][node % board->size]
+        );
+    }
+    renderer->has_frame = true;
+
+    fwrite(renderer->buffer, 1, length, stdout);
+    return;
+}
+
+
+// Write the board on the buffer
+// Returns the number of characters written
+int render_board(Board* board, char* out) {
     // Format of the board:
     // 1 -- 2 -- 3
     // | \  |  / |
@@ -539,59 +2467,97 @@ void print_board(Board* board) {
     // | /  |  \ |
     // 7 -- 8 -- 9
     // It is also printed the indices on top and left of the board
-    
-    // Print the board state
+    int length = 0;
     
     // Print the indices on top of the board
-    printf("Tabuleiro:\n");
-    printf("   |  ");
+    length += sprintf(out + length, "Tabuleiro:\n   |  ");
     for (int j = 0; j < board->size; j++) {
-        printf("%d", j);
+        out[length++] = (char) ('0' + j);
         if (j < board->size-1) {
-            printf(" | ");
+            memcpy(out + length, " | ", 3);
+            length += 3;
         }
     }
-    printf("\n");
-    printf("***************\n");
-    printf("   |  ");
-    printf("\n");
-    printf(" 0 |  ");
+    length += sprintf(out + length, "\n***************\n   |  \n");
 
-    // Print first row
-    for (int j = 0; j < board->size; j++) {
-        printf("%c", get_symbol_from_player(board->table[0][j]));
-        if (j < board->size-1) {
-            printf("---");
-        }
-    }
-    printf("\n");
-    // Print connection patterns for middle rows
-    for (int i = 1; i < board->size; i++) {
-        printf("   |  ");
-        // Print vertical connections
-        for (int j = 0; j < board->size; j++) {
-            printf("|");
-            if (j < board->size-1) {
-                // Determine connection direction
-                if ((i + j) % 2 == 0) {
-                    printf(" / ");
-                }
-                else {
-                    printf(" \\ ");
+    for (int i = 0; i < board->size; i++) {
+        // Print connection patterns between rows
+        if (i > 0) {
+            memcpy(out + length, "   |  ", 6);
+            length += 6;
+            for (int j = 0; j < board->size; j++) {
+                out[length++] = '|';
+                if (j < board->size-1) {
+                    // Determine connection direction
+                    memcpy(out + length, ((i + j) % 2 == 0) ? " / " : " \\ ", 3);
+                    length += 3;
                 }
             }
+            out[length++] = '\n';
         }
-        printf("\n");
-        printf(" %d |  ", i+1);
-        // Print numbers row
+        // Print the row index and the pieces
+        length += sprintf(out + length, " %d |  ", i);
         for (int j = 0; j < board->size; j++) {
-            printf("%c", get_symbol_from_player(board->table[i][j]));
+            out[length++] = get_symbol_from_player(board->table[i][j]);
             if (j < board->size-1) {
-                printf("---");
+                memcpy(out + length, "---", 3);
+                length += 3;
             }
         }
-        printf("\n");
+        out[length++] = '\n';
+    }
+
+    return length;
+}
+
+
+// Write the terminal commands that redraw only the changed cells
+// Returns the number of characters written
+int render_board_changes(
+    Board* board, 
+    BoardRenderer* renderer, 
+    char* out
+) {
+    int length = 0;
+
+    // Save the cursor position
+    length += sprintf(out + length, "\x1b" "7");
+    for (int node = 0; node < NUM_NODES; node++) {
+        int row = node / board->size;
+        int col = node % board->size;
+        if (board->table[row][col] != renderer->last_cells[node]) {
+            // Move to the cell and write the new symbol
+            length += sprintf(
+                out + length, 
+                "\x1b[%d;%dH%c", 
+                RENDER_FIRST_ROW_LINE + 2 * row, 
+                RENDER_FIRST_COLUMN + 4 * col,
+                get_symbol_from_player(board->table[row][col])
+            );
+        }
+    }
+    // Restore the cursor position
+    length += sprintf(out + length, "\x1b" "8");
+
+    return length;
+}
+
+
+// Initialize the renderer with the given mode
+void init_board_renderer(BoardRenderer* renderer, RenderMode mode) {
+    renderer->mode = mode;
+    renderer->has_frame = false;
+    return;
+}
+
+
+// Finish the frames of a game
+// On diff mode the scrolling region is restored
+void reset_board_renderer(BoardRenderer* renderer) {
+    if (renderer->mode == render_diff && renderer->has_frame) {
+        printf("\x1b[r");
     }
+    renderer->has_frame = false;
     return;
 }
 
@@ -599,75 +2565,75 @@ void print_board(Board* board) {
 // ***********
 // Move functions
 
-// Check if a move is valid
-bool is_valid_move(
-    Board* board, 
-    Move move, 
-    AdjacencyMatrix* adj_matrix,
-    bool print_error
-) {
-
+// Check a move of the turn player
+// Returns move_ok if the move is valid or the reason it is not
+MoveError get_move_error(Board* board, Move move, AdjacencyMatrix* adj_matrix) {
     // Check if the origin is valid
     if (!board_position_valid(board, move.origin)) {
-        if (print_error) {
-            printf("\n** MOVIMENTO INVALIDO: Posicao de origem invalida. ");
-        }
-        return false;
+        return move_invalid_origin;
     }
 
     // Check if the destiny position is valid
     if (!board_position_valid(board, move.destiny)) {
-        if (print_error) {
-            printf("\n** MOVIMENTO INVALIDO: Posicao de destino invalida. ");
-        }
-        return false;
+        return move_invalid_destiny;
     }
 
     // Check if player is moving their own piece
     if (get_player(move.origin, board) != board->turn_player) {
-        if (print_error) {
-            printf(
-                "\n **MOVIMENTO INVALIDO: Nao ha peca do jogador na posicao "
-                "escolhida. "
-            );
-        }
-        return false;
+        return move_not_own_piece;
     }
 
     // Check if the origin is the same as the destiny
     if (positions_are_equal(move.origin, move.destiny)) {
-        if (print_error) {
-            printf(
-                "\n** MOVIMENTO INVALIDO: A posicao de origem e igual a "
-                "posicao de destino. "
-            );
-        }
-        return false;
+        return move_same_position;
     }
 
     int node_a = convert_position_to_node(move.origin, board->size);
     int node_b = convert_position_to_node(move.destiny, board->size);
     // Check if the new position is not adjacent to the old position
     if (!connected(adj_matrix, node_a, node_b)) {
-        if (print_error) {
-            printf(
-                "\n** MOVIMENTO INVALIDO: A posicao de destino nao e "
-                "adjacente a posicao de origem. "
-            );
-        }
-        return false;
+        return move_not_adjacent;
     }
 
     // Check if the chosen new position is valid
     if (get_player(move.destiny, board) != id_empty) {
-        if (print_error) {
-            printf("\n** MOVIMENTO INVALIDO: Posicao ocupada. ");
-        }
-        return false;
+        return move_occupied;
     }
 
     // If all checks passed, the move is valid
-    return true;
+    return move_ok;
+}
+
+
+// Check if a move is valid
+bool is_valid_move(Board* board, Move move, AdjacencyMatrix* adj_matrix) {
+    return get_move_error(board, move, adj_matrix) == move_ok;
+}
+
+
+// Get the message shown to the player for an invalid move
+const char* get_move_error_message(MoveError error) {
+    switch (error) {
+        case move_ok:
+            return "Movimento valido.";
+        case move_invalid_origin:
+            return "Posicao de origem invalida.";
+        case move_invalid_destiny:
+            return "Posicao de destino invalida.";
+        case move_not_own_piece:
+            return "Nao ha peca do jogador na posicao escolhida.";
+        case move_same_position:
+            return "A posicao de origem e igual a posicao de destino.";
+        case move_not_adjacent:
+            return "A posicao de destino nao e adjacente a posicao de origem.";
+        case move_occupied:
+            return "Posicao ocupada.";
+        case move_game_over:
+            return "A partida ja terminou.";
+        case move_not_player_turn:
+            return "E a vez do computador.";
+    }
+    return "Erro desconhecido.";
 }
 
 
@@ -681,17 +2647,17 @@ void add_move_if_valid(
     AdjacencyMatrix* adj_matrix
 ) {
     // Initialize a new move
-    Move* move = (Move*) malloc(sizeof(Move));
+    Move* move = (Move*) malloc_tracked(sizeof(Move), memory_moves);
     move->origin = origin;
     move->destiny = destiny;
 
     // Check if the move is valid and add it to the valid moves
-    if (is_valid_move(board, *move, adj_matrix, false)) {
+    if (is_valid_move(board, *move, adj_matrix)) {
         valid_moves[*move_count] = move;
         (*move_count)++;
     } else {
         // Remove the move if it is not valid
-        free(move);
+        free_tracked(move);
     }
 
     return;
@@ -790,26 +2756,104 @@ void list_valid_moves(
 
 
 // Get the computer move by implementing a simple MIN-MAX algorithm
+// The proof-number engine plays a proven win directly and uses the MIN-MAX
+// search when no win is proven. The fast engine uses the MIN-MAX search on
+// a flat array of cells
 Move* get_computer_move(
+    Engine* engine,
     Board* board,
     int player_id,
     int computer_id,
     AdjacencyMatrix* adj_matrix
 ) {
-    // Create the root board state   
-    BoardState* root = create_board_state(NULL);
+    uint64_t start_time = get_time_microseconds();
+    uint64_t cpu_start_time = get_thread_cpu_time();
+    uint64_t trace_time = begin_trace_span(0);
+    MemoryWindow memory_window;
+    begin_memory_window(&memory_window);
+
+    Move* best_move = NULL;
+    if (engine->config.type == engine_proof_number) {
+        best_move = get_proven_move(engine, board, adj_matrix);
+    } else if (engine->config.type == engine_fast) {
+        best_move = get_fast_move(engine, board);
+    }
 
-    // Set the turn player to the computer
-    Move* best_move = get_best_move(
-        root, 
-        board, 
-        player_id, 
-        computer_id,
-        adj_matrix
-    );
+    if (best_move != NULL || engine->config.type == engine_fast) {
+        // The last search tree does not follow this move
+        clear_engine_tree(engine);
+    } else {
+        // Take the part of the last search that is still useful
+        BoardState* cache = take_reusable_subtree(
+            engine, 
+            board, 
+            computer_id, 
+            adj_matrix
+        );
 
-    // Free the allocated memory for the root state and its children
-    delete_board_state(root);
+        // Create the root board state   
+        BoardState* root = create_board_state(NULL);
+
+        // The node limit also bounds the MIN-MAX search of the proof-number
+        // engine when no win is proven
+        if (engine->config.max_nodes > 0) {
+            best_move = get_best_move_within_budget(
+                engine,
+                &root, 
+                cache,
+                board, 
+                player_id, 
+                computer_id,
+                adj_matrix
+            );
+        } else {
+            if (cache != NULL) {
+                rescale_cached_scores(
+                    cache, 
+                    engine->config.max_height - engine->tree_max_height
+                );
+            }
+            engine->tree_max_height = engine->config.max_height;
+            best_move = get_best_move(
+                engine,
+                root, 
+                cache,
+                board, 
+                player_id, 
+                computer_id,
+                adj_matrix
+            );
+        }
+        if (cache != NULL) {
+            delete_board_state(cache);
+        }
+
+        // Keep the tree for the next turn or free the allocated memory for
+        // the root state and its children
+        if (engine->config.reuse_tree && best_move != NULL) {
+            keep_search_tree(
+                engine, 
+                root, 
+                board, 
+                best_move, 
+                computer_id, 
+                adj_matrix
+            );
+        } else {
+            delete_board_state(root);
+        }
+    }
+
+    // Store the time of the move
+    int ply = min(max(board->ply, 0), MAX_RECORD_MOVES - 1);
+    record_latency(
+        &(engine->move_latency[ply]), 
+        get_time_microseconds() - start_time
+    );
+    engine->cpu_time += get_thread_cpu_time() - cpu_start_time;
+    engine->num_moves++;
+    end_memory_window(&memory_window, engine);
+    end_trace_span("get_computer_move", trace_time, 0, board->ply);
 
     // Return the best move found
     return best_move;
@@ -836,7 +2880,7 @@ Move* get_player_move(int player) {
     scanf("%d", &(destiny.col));
 
     // Allocate memory for the move
-    Move* move = malloc(sizeof(Move));
+    Move* move = (Move*) malloc_tracked(sizeof(Move), memory_moves);
     move->origin = origin;
     move->destiny = destiny;
 
@@ -845,23 +2889,16 @@ Move* get_player_move(int player) {
 }
 
 
-void make_move(
-    Board* board, 
-    Move move, 
-    bool* move_played, 
-    AdjacencyMatrix* adj_matrix
-) {
-    // Make a move for the player if it is valid
-    // Print the error message if the move is invalid
-    if (is_valid_move(board, move, adj_matrix, true)) {
+// Make a move for the turn player if it is valid
+// Returns move_ok if the move was played or the reason it is not valid
+MoveError make_move(Board* board, Move move, AdjacencyMatrix* adj_matrix) {
+    MoveError error = get_move_error(board, move, adj_matrix);
+    if (error == move_ok) {
         set_player(move.destiny, board->turn_player, board);
         set_player(move.origin, id_empty, board);
-        *move_played = true;
-    } else {
-        printf("Tente novamente.\n\n");
-        *move_played = false;
+        board->ply++;
     }
-    return;
+    return error;
 }
 
 // ***********
@@ -870,17 +2907,17 @@ void make_move(
 
 // Calculate the size of the board state
 int size_of_board_state() {
-    return (
-        sizeof(Board*) + sizeof(BoardState*) + sizeof(BoardState**)
-        + sizeof(int) * 4
-    );
+    return sizeof(BoardState) + sizeof(BoardState*) * MAX_MOVES;
 }
 
 
 // Create a new BoardState
 BoardState* create_board_state(BoardState* parent) {
     // Allocate memory for the board state
-    BoardState* new_state = (BoardState*) malloc(sizeof(BoardState));
+    BoardState* new_state = (BoardState*) malloc_tracked(
+        sizeof(BoardState), 
+        memory_board_states
+    );
     // Initialize the board
     
     // Set the parent node
@@ -891,7 +2928,10 @@ BoardState* create_board_state(BoardState* parent) {
     // the turn player on the current state
     // The maximum number of moves is defined by MAX_MOVES
     new_state->children = (
-        (BoardState**) malloc(sizeof(BoardState*) * MAX_MOVES)
+        (BoardState**) malloc_tracked(
+            sizeof(BoardState*) * MAX_MOVES, 
+            memory_board_states
+        )
     );
     for (int i = 0; i < MAX_MOVES; i++) {
         new_state->children[i] = NULL;
@@ -900,11 +2940,13 @@ BoardState* create_board_state(BoardState* parent) {
     // Initialize the children
     new_state->num_children = 0;
     new_state->child_number = -1;
+    new_state->move_number = -1;
     
     // Initialize the height of the state as an invalid value
     new_state->height = parent ? parent->height + 1 : 0;
     // Set the score of the state as a draw value and update it later
     new_state->score = 0;
+    new_state->dump_id = 0;
 
     // Return the new state
     return new_state;
@@ -913,6 +2955,10 @@ BoardState* create_board_state(BoardState* parent) {
 
 // Free the allocated memory for the board state
 void delete_board_state(BoardState* state) {
+    uint64_t trace_time = begin_trace_span(state->height);
+    int height = state->height;
+    int num_children = state->num_children;
+
     // Delete children recursively
     if (state->children != NULL) {
         for (int i = 0; i < state->num_children; i++) {
@@ -921,12 +2967,13 @@ void delete_board_state(BoardState* state) {
                 state->children[i] = NULL;
             }
         }
-        free(state->children);
+        free_tracked(state->children);
         state->children = NULL;
     }
 
     // Free the allocated memory for the state
-    free(state);
+    free_tracked(state);
+    end_trace_span("delete_board_state", trace_time, height, num_children);
     return;
 }
 
@@ -975,50 +3022,182 @@ Move* get_winning_move(
 }
 
 
+// Get the child of a cached state for the given move
+// Returns NULL if there is no cache or the move was not searched
+BoardState* get_cached_child(BoardState* cache, int move_number) {
+    if (cache == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < cache->num_children; i++) {
+        BoardState* child = cache->children[i];
+        if (child != NULL && child->move_number == move_number) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+
+// Convert a score of a cached state to the height of the current search
+// Wins and losses are worth more the closer they are to the root
+int shift_cached_score(int score, int height_difference) {
+    if (score >= SCORE_PER_HEIGHT) {
+        return score + SCORE_PER_HEIGHT * height_difference;
+    } else if (score <= -SCORE_PER_HEIGHT) {
+        return score - SCORE_PER_HEIGHT * height_difference;
+    }
+    return score;
+}
+
+
+// Convert the scores of a cached tree to a search with a different maximum
+// height
+// A win or a loss beyond the new maximum height is no longer a result of
+// the search: it keeps only its sign, for the order of the moves
+void rescale_cached_scores(BoardState* state, int max_height_difference) {
+    if (max_height_difference == 0) {
+        return;
+    }
+    int score = shift_cached_score(state->score, max_height_difference);
+    if (abs(state->score) >= SCORE_PER_HEIGHT 
+        && abs(score) < SCORE_PER_HEIGHT) {
+        score = (state->score > 0) ? MAX_EVALUATION : -MAX_EVALUATION;
+    }
+    state->score = score;
+    for (int i = 0; i < state->num_children; i++) {
+        if (state->children[i] != NULL) {
+            rescale_cached_scores(state->children[i], max_height_difference);
+        }
+    }
+    return;
+}
+
+
+// Order the moves by the scores of the cached children
+// The best moves for the turn player come first, the moves without a
+// cached child count as draws, and equal moves keep the original order
+void order_moves_by_cache(
+    BoardState* cache, 
+    int num_moves, 
+    bool maximize, 
+    int* order
+) {
+    int keys[MAX_MOVES];
+    for (int i = 0; i < num_moves; i++) {
+        BoardState* child = get_cached_child(cache, i);
+        int score = (child != NULL) ? child->score : 0;
+        keys[i] = maximize ? score : -score;
+
+        // Insertion sort (stable) by decreasing key
+        int j = i;
+        while (j > 0 && keys[order[j - 1]] < keys[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+    }
+    return;
+}
+
+
 // Get the best move for the computer from the current state
-// Return 0 if MAX_TREE_HEIGHT is reached
+// At the maximum height, return the static evaluation (or 0 if the
+// evaluation is disabled)
+// The search does not change the ply of the board, so the moves left until
+// the turn limit are counted from the ply of the root. Lines that reach
+// the limit, or can not end before it, are draws.
+// The cache is the state of a previous search for the same position (or
+// NULL): its proven results are reused and its scores order the moves
 int calculate_state_score(
     BoardState* state, 
+    BoardState* cache,
     Board* board, 
     int player, 
     int computer_player,
+    EngineConfig* config,
     AdjacencyMatrix* adj_matrix
 ) {
+    if (tree_dump.enabled) {
+        state->dump_id = get_tree_dump_id();
+    }
+
+    // The game ends as a draw after MAX_RECORD_MOVES moves (the distances
+    // matter only when less than 2 * BOARD_SIZE moves are left)
+    int plies_left = MAX_RECORD_MOVES - board->ply - state->height;
+    int other_player = (board->turn_player == computer_player) 
+        ? player : computer_player;
+    if (plies_left < 2 * BOARD_SIZE && is_turn_limit_draw(
+            get_line_distance(board, board->turn_player), 
+            get_line_distance(board, other_player), 
+            plies_left)) {
+        thread_cutoff_reason = cutoff_turn_limit;
+        return 0;
+    }
+
     // Get the valid moves for the computer
-    if (state->height > MAX_TREE_HEIGHT) {
-        return 0; // Search limit reached
+    if (state->height > config->max_height) {
+        // Search limit reached
+        thread_cutoff_reason = cutoff_horizon;
+        if (!config->use_evaluation) {
+            return 0;
+        }
+        return evaluate_board(
+            board, 
+            computer_player, 
+            config->eval_weights, 
+            adj_matrix
+        );
+    }
+
+    // A win or a loss found by the previous search is still valid
+    // (evaluations are smaller than a win and must be searched again)
+    if (cache != NULL && abs(cache->score) >= SCORE_PER_HEIGHT) {
+        thread_cutoff_reason = cutoff_cached;
+        return shift_cached_score(cache->score, cache->height - state->height);
     }
 
     // Get all valid moves for the current player
-    Move** moves = (Move**) malloc(sizeof(Move*) * MAX_MOVES);
+    Move** moves = (Move**) malloc_tracked(
+        sizeof(Move*) * MAX_MOVES, 
+        memory_move_lists
+    );
     int num_moves = 0;
 
+    uint64_t trace_time = begin_trace_span(state->height);
     list_valid_moves(
         board, 
         moves,
         &num_moves,
         adj_matrix
     );
+    end_trace_span("list_valid_moves", trace_time, state->height, num_moves);
 
     // Verify if any move is a winning move
+    trace_time = begin_trace_span(state->height);
     Move* winning_move = get_winning_move(
         state, 
         board,
         moves, 
         num_moves
     );
+    end_trace_span(
+        "get_winning_move", 
+        trace_time, 
+        state->height, 
+        winning_move != NULL
+    );
     
     // If can win from this position
     if (winning_move != NULL) {
 
         // Free the allocated memory for the moves
         for (int i = 0; i < num_moves; i++) {
-            free(moves[i]);
+            free_tracked(moves[i]);
         }
-        free(moves);
+        free_tracked(moves);
 
         // Set the player on the winning move
-        int value = 10 * (MAX_TREE_HEIGHT - state->height + 1);
+        int value = SCORE_PER_HEIGHT * (config->max_height - state->height + 1);
 
         if (board->turn_player == computer_player) {
             // If the computer is the turn player, return a positive score
@@ -1028,14 +3207,33 @@ int calculate_state_score(
             value = -value;
         }
 
+        thread_cutoff_reason = cutoff_winning_move;
         return value;
     }
 
+    // A player without valid moves ends the game as a draw
+    if (num_moves == 0) {
+        free_tracked(moves);
+        thread_cutoff_reason = cutoff_no_moves;
+        return 0;
+    }
+
+    // Search first the moves that were the best on the previous search
+    int order[MAX_MOVES];
+    order_moves_by_cache(
+        cache, 
+        num_moves, 
+        board->turn_player == computer_player, 
+        order
+    );
+
     bool found_turn_win = false;
     // If no winning move was found, make all moves and calculate the score
-    for (int i = 0; i < num_moves && !found_turn_win; i++) {
+    for (int k = 0; k < num_moves && !found_turn_win; k++) {
+        int i = order[k];
         // Create a new board state
         BoardState* new_state = create_board_state(state);
+        new_state->move_number = i;
         
         // Make the move
         set_player(moves[i]->destiny, board->turn_player, board);
@@ -1050,9 +3248,11 @@ int calculate_state_score(
         // Recursively check the game result from the new state
         int result = calculate_state_score(
             new_state, 
+            get_cached_child(cache, i),
             board,
             player,
             computer_player,
+            config,
             adj_matrix
         );
 
@@ -1068,15 +3268,28 @@ int calculate_state_score(
         
         // Store result
         new_state->score = result;
+        if (new_state->dump_id != 0) {
+            write_tree_dump_node(
+                new_state->dump_id, 
+                state->dump_id, 
+                encode_move(*moves[i]), 
+                new_state->height, 
+                result, 
+                thread_cutoff_reason
+            );
+        }
 
         // Store the new state in the children
         state->children[state->num_children] = new_state;
         new_state->child_number = state->num_children;
         state->num_children++;
 
+        // Stop at a win for the turn player (evaluations are not wins)
         found_turn_win = (
-            (board->turn_player == computer_player && result > 0) ||
-            (board->turn_player != computer_player && result < 0)
+            (board->turn_player == computer_player 
+                && result >= SCORE_PER_HEIGHT) ||
+            (board->turn_player != computer_player 
+                && result <= -SCORE_PER_HEIGHT)
         );
     }
     
@@ -1096,11 +3309,14 @@ int calculate_state_score(
 
     // Free the allocated memory for the moves
     for (int i = 0; i < num_moves; i++) {
-        free(moves[i]);
+        free_tracked(moves[i]);
     }
-    free(moves);
+    free_tracked(moves);
 
     // Return the total result
+    thread_cutoff_reason = (
+        (state->num_children < num_moves) ? cutoff_win_found : cutoff_none
+    );
     return best_score;
     
 }
@@ -1109,17 +3325,22 @@ int calculate_state_score(
 // Calculate the most profitable move for root
 void calculate_root_children_score(
     BoardState* root,
+    BoardState* cache,
     Board* board,
     int player_id,
     int computer_id,
+    EngineConfig* config,
     Move** moves,
     int num_moves,
     AdjacencyMatrix* adj_matrix
 ) {
     // For each move, create a new board state and calculate the score
     for (int i = 0; i < num_moves; i++) {
+        uint64_t trace_time = begin_trace_span(1);
+
         // Create a new board state
         BoardState* new_state = create_board_state(root);
+        new_state->move_number = i;
 
         // Make the move
         set_player(moves[i]->destiny, board->turn_player, board);
@@ -1130,14 +3351,26 @@ void calculate_root_children_score(
         // Calculate the game result from the new state
         int result = calculate_state_score(
             new_state, 
+            get_cached_child(cache, i),
             board,
             player_id,
             computer_id,
+            config,
             adj_matrix
         );
 
         // Store the score in the new state
         new_state->score = result;
+        if (new_state->dump_id != 0) {
+            write_tree_dump_node(
+                new_state->dump_id, 
+                root->dump_id, 
+                encode_move(*moves[i]), 
+                new_state->height, 
+                result, 
+                thread_cutoff_reason
+            );
+        }
         
         // Reset the turn player to the computer
         board->turn_player = computer_id;
@@ -1151,73 +3384,112 @@ void calculate_root_children_score(
         root->children[root->num_children] = new_state;
         new_state->child_number = root->num_children;
         root->num_children++;
+
+        end_trace_span("root_child", trace_time, 1, i);
     }
 
     return;
 }
 
-// Get the position of the move with the highest score
-int get_move_with_highest_score_position(
-    BoardState** children, 
-    int num_children, 
-    int computer_id
-) {
- 
+// Get the position of the highest score
+// Ties are broken uniformly at random (reservoir sampling)
+int get_highest_score_position(int* scores, int num_scores, Rng* rng) {
     // Start with first score
-    int best_score = children[0]->score;
-    int best_move_pos = 0;
+    int best_score = scores[0];
+    int best_position = 0;
+    // Number of moves with the best score seen so far
+    int num_best = 1;
 
-    // Iterate through the children to find the best move
-    for (int i = 1; i < num_children; i++) {
-    
-        // Get the score of the child state
-        int score = children[i]->score;
-        
+    for (int i = 1; i < num_scores; i++) {
         // If the score is better than the current best score, update it
-        if (score > best_score) {
-            best_score = score;
-            best_move_pos = i;
-        } else if (score == best_score) {
-            // Choose randomly between the moves with the same score
-            if (rand() % 2 == 0) {
-                best_move_pos = i; // Randomly choose this move
+        if (scores[i] > best_score) {
+            best_score = scores[i];
+            best_position = i;
+            num_best = 1;
+        } else if (scores[i] == best_score) {
+            // Keep this move with probability 1 / num_best, so all moves
+            // with the same score have the same chance of being chosen
+            num_best++;
+            if (random_below(rng, num_best) == 0) {
+                best_position = i;
             }
         }
     }
+    return best_position;
+}
+
 
-    // Return the position of the best move
-    return best_move_pos;
+// Get the position of the move with the highest score
+int get_move_with_highest_score_position(
+    BoardState** children, 
+    int num_children, 
+    int computer_id,
+    Rng* rng
+) {
+    int scores[MAX_MOVES];
+    for (int i = 0; i < num_children; i++) {
+        scores[i] = children[i]->score;
+    }
+    return get_highest_score_position(scores, num_children, rng);
 }
 
 
 // Get the best move for the computer
 Move* get_best_move(
+    Engine* engine,
     BoardState* root, 
+    BoardState* cache,
     Board* board, 
     int player_id, 
     int computer_id,
     AdjacencyMatrix* adj_matrix
 ) {
     // Get the valid moves for the computer
-    Move** moves = (Move**) malloc(sizeof(Move*) * MAX_MOVES);
+    Move** moves = (Move**) malloc_tracked(
+        sizeof(Move*) * MAX_MOVES, 
+        memory_move_lists
+    );
     int num_moves = 0;
+    uint64_t trace_time = begin_trace_span(0);
     list_valid_moves(
         board, 
         moves,
         &num_moves,
         adj_matrix
     );
+    end_trace_span("list_valid_moves", trace_time, 0, num_moves);
+
+    // There is no move if all pieces are blocked
+    if (num_moves == 0) {
+        free_tracked(moves);
+        return NULL;
+    }
 
     // Verify if there is a winning move
+    trace_time = begin_trace_span(0);
     Move* best_move = get_winning_move(root, board, moves, num_moves);
+    end_trace_span("get_winning_move", trace_time, 0, best_move != NULL);
+    if (tree_dump.enabled) {
+        root->dump_id = get_tree_dump_id();
+    }
     if (best_move != NULL) {
+        if (root->dump_id != 0) {
+            write_tree_dump_node(
+                root->dump_id, 
+                0, 
+                TREE_DUMP_NO_MOVE, 
+                0, 
+                SCORE_PER_HEIGHT * (engine->config.max_height + 1), 
+                cutoff_winning_move
+            );
+        }
         // Free the allocated memory for the moves except the best move
         for (int i = 0; i < num_moves; i++) {
             if (moves[i] != best_move) {
-                free(moves[i]);
+                free_tracked(moves[i]);
             }
         }
-        free(moves);
+        free_tracked(moves);
         // If there is a winning move, return it
         return best_move;
     }
@@ -1225,9 +3497,11 @@ Move* get_best_move(
     // If no winning move was found, calculate each children score
     calculate_root_children_score(
         root, 
+        cache,
         board,
         player_id,
         computer_id,
+        &(engine->config),
         moves,
         num_moves,
         adj_matrix
@@ -1237,56 +3511,5895 @@ Move* get_best_move(
     int best_move_pos = get_move_with_highest_score_position(
         root->children, 
         root->num_children, 
-        computer_id
+        computer_id,
+        &(engine->rng)
     );
     best_move = moves[best_move_pos];
+    if (root->dump_id != 0) {
+        write_tree_dump_node(
+            root->dump_id, 
+            0, 
+            TREE_DUMP_NO_MOVE, 
+            0, 
+            root->children[best_move_pos]->score, 
+            cutoff_none
+        );
+    }
 
     // Free the allocated memory for the moves except the best move
     for (int i = 0; i < num_moves; i++) {
         if (i != best_move_pos) {
-            free(moves[i]);
+            free_tracked(moves[i]);
         }
     }
-    free(moves);
+    free_tracked(moves);
 
     // If there is a best move, return it
     return best_move;
 }
 
+// Search with increasing heights while the next height is expected to fit
+// in the node budget of the engine (up to the maximum height)
+// The first search uses the cache of the last turn and each deeper search
+// uses the tree of the previous one, with the scores converted to its height
+// The root is replaced by the root of the last search
+Move* get_best_move_within_budget(
+    Engine* engine,
+    BoardState** root, 
+    BoardState* cache,
+    Board* board, 
+    int player_id, 
+    int computer_id,
+    AdjacencyMatrix* adj_matrix
+) {
+    int max_height = engine->config.max_height;
+    long long total_nodes = 0;
+    long long last_nodes = 0;
+    Move* best_move = NULL;
+    BoardState* last_root = NULL;
+    int cache_height = engine->tree_max_height;
+    for (int height = 0; height <= max_height; height++) {
+        if (best_move != NULL) {
+            free_tracked(best_move);
+            if (last_root != NULL) {
+                delete_board_state(last_root);
+            }
+            last_root = *root;
+            cache = last_root;
+            *root = create_board_state(NULL);
+        }
+        if (cache != NULL) {
+            rescale_cached_scores(cache, height - cache_height);
+        }
+        cache_height = height;
+        engine->config.max_height = height;
+        best_move = get_best_move(
+            engine, 
+            *root, 
+            cache, 
+            board, 
+            player_id, 
+            computer_id, 
+            adj_matrix
+        );
 
-// **********
-// Game functions
+        // A winning move (or no move) needs no deeper search
+        if (best_move == NULL || (*root)->num_children == 0) {
+            break;
+        }
 
-// Check a win on a row
-bool win_by_row(Board* board, int row) {
-    // Check if all pieces in the row are the same as the turn player
-    for (int j = 0; j < board->size; j++) {
-        // If there is a position without the turn player, it is not a win
-        if (board->table[row][j] != board->turn_player) {
-            return false; 
+        // Estimate the next search from the growth of the last one
+        long long nodes = count_board_states(*root);
+        long long next_nodes = (
+            (last_nodes > 0) ? nodes * nodes / last_nodes : nodes * MAX_MOVES
+        );
+        total_nodes += nodes;
+        last_nodes = nodes;
+        if (total_nodes + next_nodes > engine->config.max_nodes) {
+            break;
         }
     }
-    return true;
+    if (last_root != NULL) {
+        delete_board_state(last_root);
+    }
+    engine->tree_max_height = engine->config.max_height;
+    engine->config.max_height = max_height;
+    return best_move;
 }
 
 
-// Check a win on a column
-bool win_by_column(Board* board, int col) {
-    // Check if all pieces in the column are the same as the turn player
-    for (int i = 0; i < board->size; i++) {
-        // If there is a position without the turn player, it is not a win
-        if (board->table[i][col] != board->turn_player) {
-            return false; 
-        }
+// Get the first move of a forced win found by the proof-number search
+// Returns NULL if no win is proven within the node budget
+Move* get_proven_move(
+    Engine* engine, 
+    Board* board, 
+    AdjacencyMatrix* adj_matrix
+) {
+    // The game ends as a draw after MAX_RECORD_MOVES moves
+    int plies_left = MAX_RECORD_MOVES - board->ply;
+    if (plies_left <= 0) {
+        return NULL;
     }
-    // If all positions have the same player, it is a win
-    return true;
+    int max_nodes = (
+        (engine->config.max_nodes > 0) 
+        ? engine->config.max_nodes : PROOF_ENGINE_NODES
+    );
+    ProofResult result;
+    prove_position(board, plies_left, max_nodes, adj_matrix, &result);
+    if (result.status != proof_proven || result.num_moves == 0) {
+        return NULL;
+    }
+
+    Move* move = (Move*) malloc_tracked(sizeof(Move), memory_moves);
+    *move = decode_move(result.moves[0]);
+    return move;
 }
 
 
-// Check main diagonal
-bool win_by_main_diagonal(Board* board) {
-    // Check if all pieces in the main diagonal are the same as the turn player
+
+// **********
+// Rules functions
+
+// Find a variant by name
+// Returns -1 if there is no variant with the name
+int find_variant(const char* name) {
+    for (int i = 0; i < NUM_VARIANTS; i++) {
+        if (strcmp(VARIANT_DEFINITIONS[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+// Build the move and line tables of a variant from its definition
+// The neighbors of each node are sorted in the order of list_valid_moves
+// (down, up, right, left, down-right, up-left, down-left, up-right)
+// Returns false if the definition is not valid
+bool compile_rules(const RulesDefinition* definition, Rules* rules) {
+    const int row_steps[8] = {1, -1, 0, 0, 1, -1, 1, -1};
+    const int col_steps[8] = {0, 0, 1, -1, 1, -1, -1, 1};
+
+    rules->name = definition->name;
+    rules->num_pieces = definition->num_pieces;
+    rules->drop_phase = definition->drop_phase;
+    rules->center = definition->center;
+
+    // Neighbors (edges are undirected)
+    bool edges[NUM_NODES][NUM_NODES];
+    memset(edges, 0, sizeof(edges));
+    for (int i = 0; i < definition->num_edges; i++) {
+        int a = definition->edges[i][0];
+        int b = definition->edges[i][1];
+        if (a < 0 || a >= NUM_NODES || b < 0 || b >= NUM_NODES || a == b) {
+            return false;
+        }
+        edges[a][b] = true;
+        edges[b][a] = true;
+    }
+    for (int node = 0; node < NUM_NODES; node++) {
+        int row = node / BOARD_SIZE;
+        int col = node % BOARD_SIZE;
+        rules->num_neighbors[node] = 0;
+        for (int i = 0; i < 8; i++) {
+            int other_row = row + row_steps[i];
+            int other_col = col + col_steps[i];
+            if (other_row < 0 || other_row >= BOARD_SIZE 
+                || other_col < 0 || other_col >= BOARD_SIZE) {
+                continue;
+            }
+            int other = other_row * BOARD_SIZE + other_col;
+            if (edges[node][other]) {
+                rules->neighbors[node][rules->num_neighbors[node]] = other;
+                rules->num_neighbors[node]++;
+                edges[node][other] = false;
+            }
+        }
+        // Edges must join nodes that are next to each other on the grid
+        for (int other = 0; other < NUM_NODES; other++) {
+            if (edges[node][other]) {
+                return false;
+            }
+        }
+    }
+
+    // Winning lines of each player (without its excluded line)
+    if (definition->num_lines > NUM_LINES) {
+        return false;
+    }
+    for (int player = 0; player < 2; player++) {
+        rules->num_lines[player] = 0;
+        for (int line = 0; line < definition->num_lines; line++) {
+            if (line == definition->home_lines[player]) {
+                continue;
+            }
+            for (int i = 0; i < BOARD_SIZE; i++) {
+                int node = definition->lines[line][i];
+                if (node < 0 || node >= NUM_NODES) {
+                    return false;
+                }
+                rules->lines[player][rules->num_lines[player]][i] = node;
+            }
+            rules->num_lines[player]++;
+        }
+    }
+
+    // Start position
+    if ((int) strlen(definition->start) != NUM_NODES) {
+        return false;
+    }
+    int num_pieces[3] = {0, 0, 0};
+    for (int node = 0; node < NUM_NODES; node++) {
+        int cell = get_player_from_symbol(definition->start[node]);
+        rules->start[node] = (unsigned char) cell;
+        num_pieces[cell]++;
+    }
+    // Without a drop phase all pieces start on the board
+    int start_pieces = definition->drop_phase ? 0 : definition->num_pieces;
+    return (
+        num_pieces[id_player_1] == start_pieces 
+        && num_pieces[id_player_2] == start_pieces
+        && 2 * definition->num_pieces <= NUM_NODES
+    );
+}
+
+
+// Compile the rules of all variants (once, at startup)
+void compile_all_rules() {
+    for (int i = 0; i < NUM_VARIANTS; i++) {
+        if (!compile_rules(&(VARIANT_DEFINITIONS[i]), &(variant_rules[i]))) {
+            printf("Regras invalidas: %s\n", VARIANT_DEFINITIONS[i].name);
+            exit(1);
+        }
+    }
+    return;
+}
+
+
+// Check if the player has one of its winning lines
+bool rules_have_line(const Rules* rules, unsigned char* cells, int player) {
+    for (int line = 0; line < rules->num_lines[player]; line++) {
+        const int* nodes = rules->lines[player][line];
+        if (cells[nodes[0]] == player && cells[nodes[1]] == player 
+            && cells[nodes[2]] == player) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Make an encoded move (origin node * NUM_NODES + destiny node)
+// A piece is dropped when the origin is the destiny
+void apply_encoded_move(unsigned char* cells, int move, int player) {
+    cells[move / NUM_NODES] = id_empty;
+    cells[move % NUM_NODES] = player;
+    return;
+}
+
+
+// Undo an encoded move
+void undo_encoded_move(unsigned char* cells, int move, int player) {
+    cells[move % NUM_NODES] = id_empty;
+    if (move / NUM_NODES != move % NUM_NODES) {
+        cells[move / NUM_NODES] = player;
+    }
+    return;
+}
+
+
+// List the encoded moves of the player
+// While the player has pieces to drop, the moves are drops on the empty
+// nodes. Then the moves are in the order of list_valid_moves
+int list_rules_moves(
+    const Rules* rules, 
+    unsigned char* cells, 
+    int player, 
+    unsigned char* moves
+) {
+    int num_moves = 0;
+    if (rules->drop_phase) {
+        int num_pieces = 0;
+        for (int node = 0; node < NUM_NODES; node++) {
+            num_pieces += (cells[node] == player);
+        }
+        if (num_pieces < rules->num_pieces) {
+            for (int node = 0; node < NUM_NODES; node++) {
+                if (cells[node] == id_empty) {
+                    moves[num_moves] = (unsigned char) (node * NUM_NODES + node);
+                    num_moves++;
+                }
+            }
+            return num_moves;
+        }
+    }
+
+    for (int node = 0; node < NUM_NODES; node++) {
+        if (cells[node] != player) {
+            continue;
+        }
+        for (int i = 0; i < rules->num_neighbors[node]; i++) {
+            int other = rules->neighbors[node][i];
+            if (cells[other] == id_empty) {
+                moves[num_moves] = (unsigned char) (node * NUM_NODES + other);
+                num_moves++;
+            }
+        }
+    }
+    return num_moves;
+}
+
+
+// Get the number of pieces of a player missing on its closest winning line
+int get_rules_line_distance(
+    const Rules* rules, 
+    unsigned char* cells, 
+    int player
+) {
+    int best_count = 0;
+    for (int line = 0; line < rules->num_lines[player]; line++) {
+        int count = 0;
+        for (int i = 0; i < BOARD_SIZE; i++) {
+            count += (cells[rules->lines[player][line][i]] == player);
+        }
+        best_count = max(best_count, count);
+    }
+    return BOARD_SIZE - best_count;
+}
+
+
+// Play a game of a variant between two engines (with the fast search)
+// Returns the winner id or id_empty for a draw
+int play_variant_game(const Rules* rules, Engine** engines, GameRecord* record) {
+    unsigned char cells[NUM_NODES];
+    memcpy(cells, rules->start, NUM_NODES);
+
+    int winner = id_empty;
+    for (int i = 0; i < MAX_RECORD_MOVES && winner == id_empty; i++) {
+        int player = (i % 2 == 0) ? id_player_1 : id_player_2;
+        int move = select_fast_move(
+            engines[player], 
+            rules, 
+            cells, 
+            player, 
+            MAX_RECORD_MOVES - i
+        );
+        // A player without valid moves ends the game as a draw
+        if (move == -1) {
+            break;
+        }
+        apply_encoded_move(cells, move, player);
+        record->moves[record->num_moves] = (unsigned char) move;
+        record->num_moves++;
+        if (rules_have_line(rules, cells, player)) {
+            winner = player;
+        }
+    }
+    record->result = winner;
+    return winner;
+}
+
+
+// **********
+// Position index functions
+// Positions with the same number of pieces of each player are numbered
+// from 0 to num_positions - 1: the set of nodes of player 1 (among all the
+// nodes), the set of nodes of player 2 (among the nodes left) and the turn
+// player, so dense arrays can be used instead of hash tables. The sets are
+// numbered in increasing mask order. position_index numbers the positions
+// with NUM_PIECES pieces (NUM_POSITION_INDICES of them) and the solver
+// those of its variant.
+
+// Build the tables of an index of positions with num_pieces pieces of each
+// player (1 to NUM_NODES / 2)
+void init_position_index(PositionIndex* index, int num_pieces) {
+    index->num_pieces = num_pieces;
+
+    // Sets of num_pieces nodes of the whole board, in increasing mask order
+    int num_sets = 0;
+    for (int mask = 0; mask < (1 << NUM_NODES); mask++) {
+        if (__builtin_popcount(mask) == num_pieces) {
+            index->set_rank[mask] = (unsigned char) num_sets;
+            index->set_masks[num_sets] = (unsigned short) mask;
+            num_sets++;
+        } else {
+            index->set_rank[mask] = POSITION_INDEX_INVALID;
+        }
+    }
+    index->num_sets = num_sets;
+
+    // Sets of num_pieces nodes of the nodes left by player 1
+    int num_free = NUM_NODES - num_pieces;
+    num_sets = 0;
+    for (int mask = 0; mask < (1 << NUM_NODES); mask++) {
+        if (mask < (1 << num_free) && __builtin_popcount(mask) == num_pieces) {
+            index->free_set_rank[mask] = (unsigned char) num_sets;
+            index->free_set_masks[num_sets] = (unsigned short) mask;
+            num_sets++;
+        } else {
+            index->free_set_rank[mask] = POSITION_INDEX_INVALID;
+        }
+    }
+    index->num_free_sets = num_sets;
+    index->num_positions = index->num_sets * index->num_free_sets * 2;
+
+    // Nodes left by each set of player 1 and their positions on that list
+    for (int set = 0; set < index->num_sets; set++) {
+        int slot = 0;
+        for (int node = 0; node < NUM_NODES; node++) {
+            if (index->set_masks[set] & (1 << node)) {
+                index->free_slots[set][node] = 0;
+            } else {
+                index->free_slots[set][node] = (unsigned char) slot;
+                index->free_nodes[set][slot] = (unsigned char) node;
+                slot++;
+            }
+        }
+    }
+    return;
+}
+
+
+// Index of a position (cells and turn player)
+// Returns -1 if the position does not have the pieces of the index
+int rank_indexed_position(
+    const PositionIndex* index, 
+    unsigned char* cells, 
+    int turn_player
+) {
+    int mask_1 = 0;
+    int mask_2 = 0;
+    for (int node = 0; node < NUM_NODES; node++) {
+        mask_1 |= (cells[node] == id_player_1) << node;
+        mask_2 |= (cells[node] == id_player_2) << node;
+    }
+    int set_1 = index->set_rank[mask_1];
+    if (set_1 == POSITION_INDEX_INVALID) {
+        return -1;
+    }
+
+    // Number the nodes of player 2 among the nodes left by player 1
+    int free_mask = 0;
+    for (int node = 0; node < NUM_NODES; node++) {
+        free_mask |= ((mask_2 >> node) & 1) << index->free_slots[set_1][node];
+    }
+    int set_2 = index->free_set_rank[free_mask];
+    if (set_2 == POSITION_INDEX_INVALID) {
+        return -1;
+    }
+    return (set_1 * index->num_free_sets + set_2) * 2 + turn_player;
+}
+
+
+// Position of an index (the inverse of rank_indexed_position)
+void unrank_indexed_position(
+    const PositionIndex* index, 
+    int rank, 
+    unsigned char* cells, 
+    int* turn_player
+) {
+    *turn_player = rank % 2;
+    int set_2 = (rank / 2) % index->num_free_sets;
+    int set_1 = (rank / 2) / index->num_free_sets;
+
+    int mask_1 = index->set_masks[set_1];
+    for (int node = 0; node < NUM_NODES; node++) {
+        cells[node] = ((mask_1 >> node) & 1) ? id_player_1 : id_empty;
+    }
+    int free_mask = index->free_set_masks[set_2];
+    for (int slot = 0; slot < NUM_NODES - index->num_pieces; slot++) {
+        if ((free_mask >> slot) & 1) {
+            cells[index->free_nodes[set_1][slot]] = id_player_2;
+        }
+    }
+    return;
+}
+
+
+// Index of a position with NUM_PIECES pieces of each player
+// Returns -1 if the position does not have NUM_PIECES pieces of each player
+int rank_position(unsigned char* cells, int turn_player) {
+    return rank_indexed_position(&position_index, cells, turn_player);
+}
+
+
+// Position of an index (the inverse of rank_position)
+void unrank_position(int rank, unsigned char* cells, int* turn_player) {
+    unrank_indexed_position(&position_index, rank, cells, turn_player);
+    return;
+}
+
+
+// **********
+// Fast search functions
+// Same search as calculate_state_score on a flat array of cells, without
+// allocations or a tree. The moves come from the compiled rules of the
+// variant, in the same order as list_valid_moves for the classic game, so
+// the early stop at a win gives the same scores
+
+// Prepare a search with the rules of a variant from a position with
+// plies_left moves until the turn limit
+void init_fast_search(
+    FastSearch* search, 
+    EngineConfig* config, 
+    const Rules* rules, 
+    int plies_left
+) {
+    search->rules = rules;
+    search->config = *config;
+    search->plies_left = plies_left;
+    search->nodes = 0;
+    return;
+}
+
+
+// Copy the cells of a board (row by row)
+void get_board_cells(Board* board, unsigned char* cells) {
+    for (int node = 0; node < NUM_NODES; node++) {
+        cells[node] = board->table[node / board->size][node % board->size];
+    }
+    return;
+}
+
+
+// Same value as evaluate_board (with the lines of the variant)
+int fast_evaluate(FastSearch* search, unsigned char* cells, int player) {
+    const Rules* rules = search->rules;
+    int differences[NUM_EVAL_FEATURES] = {0, 0, 0, 0};
+    for (int side = 0; side < 2; side++) {
+        int current = (side == 0) ? player : 1 - player;
+        int sign = (side == 0) ? 1 : -1;
+
+        // Mobility
+        int mobility = 0;
+        for (int node = 0; node < NUM_NODES; node++) {
+            if (cells[node] != current) {
+                continue;
+            }
+            for (int i = 0; i < rules->num_neighbors[node]; i++) {
+                if (cells[rules->neighbors[node][i]] == id_empty) {
+                    mobility++;
+                }
+            }
+        }
+
+        // Threats and distance to a winning line
+        int threats = 0;
+        int best_count = 0;
+        for (int line = 0; line < rules->num_lines[current]; line++) {
+            int count = 0;
+            int empty = 0;
+            for (int i = 0; i < BOARD_SIZE; i++) {
+                int cell = cells[rules->lines[current][line][i]];
+                count += (cell == current);
+                empty += (cell == id_empty);
+            }
+            if (count == BOARD_SIZE - 1 && empty == 1) {
+                threats++;
+            }
+            best_count = max(best_count, count);
+        }
+
+        differences[feature_mobility] += sign * mobility;
+        if (rules->center != -1) {
+            differences[feature_center] += sign * (cells[rules->center] == current);
+        }
+        differences[feature_threats] += sign * threats;
+        // The distance is inverted so that a positive value is good
+        differences[feature_line_distance] -= sign * (BOARD_SIZE - best_count);
+    }
+
+    int value = 0;
+    for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+        value += search->config.eval_weights[i] * differences[i];
+    }
+    return max(-MAX_EVALUATION, min(MAX_EVALUATION, value));
+}
+
+
+// Same score as calculate_state_score without a cache
+int fast_state_score(
+    FastSearch* search, 
+    unsigned char* cells, 
+    int turn_player, 
+    int height
+) {
+    search->nodes++;
+    int computer_id = search->computer_id;
+    int plies_left = search->plies_left - height;
+    int other_player = (turn_player == id_player_1) ? id_player_2 : id_player_1;
+    if (plies_left < 2 * BOARD_SIZE && is_turn_limit_draw(
+            get_rules_line_distance(search->rules, cells, turn_player), 
+            get_rules_line_distance(search->rules, cells, other_player), 
+            plies_left)) {
+        return 0;
+    }
+
+    if (height > search->config.max_height) {
+        if (!search->config.use_evaluation) {
+            return 0;
+        }
+        return fast_evaluate(search, cells, computer_id);
+    }
+
+    unsigned char moves[MAX_MOVES];
+    int num_moves = list_rules_moves(search->rules, cells, turn_player, moves);
+
+    // A win on this turn
+    for (int i = 0; i < num_moves; i++) {
+        apply_encoded_move(cells, moves[i], turn_player);
+        bool win = rules_have_line(search->rules, cells, turn_player);
+        undo_encoded_move(cells, moves[i], turn_player);
+        if (win) {
+            int value = (
+                SCORE_PER_HEIGHT * (search->config.max_height - height + 1)
+            );
+            return (turn_player == computer_id) ? value : -value;
+        }
+    }
+
+    // A player without valid moves ends the game as a draw
+    if (num_moves == 0) {
+        return 0;
+    }
+
+    bool maximize = (turn_player == computer_id);
+    int best_score = 0;
+    for (int i = 0; i < num_moves; i++) {
+        apply_encoded_move(cells, moves[i], turn_player);
+        int result = fast_state_score(search, cells, other_player, height + 1);
+        undo_encoded_move(cells, moves[i], turn_player);
+
+        if (i == 0) {
+            best_score = result;
+        } else {
+            best_score = maximize 
+                ? max(best_score, result) : min(best_score, result);
+        }
+
+        // Stop at a win for the turn player (evaluations are not wins)
+        if ((maximize && result >= SCORE_PER_HEIGHT) 
+            || (!maximize && result <= -SCORE_PER_HEIGHT)) {
+            break;
+        }
+    }
+    return best_score;
+}
+
+
+// Score of each move of the turn player (the computer), in the order of
+// the moves of the rules, as calculate_root_children_score
+// Returns the number of moves
+int fast_root_scores(
+    FastSearch* search, 
+    unsigned char* cells, 
+    int computer_id, 
+    int* scores
+) {
+    int player_id = (computer_id == id_player_1) ? id_player_2 : id_player_1;
+    search->computer_id = computer_id;
+
+    unsigned char moves[MAX_MOVES];
+    int num_moves = list_rules_moves(search->rules, cells, computer_id, moves);
+    for (int i = 0; i < num_moves; i++) {
+        apply_encoded_move(cells, moves[i], computer_id);
+        scores[i] = fast_state_score(search, cells, player_id, 1);
+        undo_encoded_move(cells, moves[i], computer_id);
+    }
+    return num_moves;
+}
+
+
+// Choose the move of the fast engine for the player
+// Same choice as get_best_move without reusing the tree: a winning move is
+// played at once, otherwise the best score (ties broken at random)
+// Returns the encoded move or -1 if the player has no moves
+int select_fast_move(
+    Engine* engine, 
+    const Rules* rules, 
+    unsigned char* cells, 
+    int player, 
+    int plies_left
+) {
+    unsigned char moves[MAX_MOVES];
+    int num_moves = list_rules_moves(rules, cells, player, moves);
+    if (num_moves == 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < num_moves; i++) {
+        apply_encoded_move(cells, moves[i], player);
+        bool win = rules_have_line(rules, cells, player);
+        undo_encoded_move(cells, moves[i], player);
+        if (win) {
+            return moves[i];
+        }
+    }
+
+    FastSearch search;
+    init_fast_search(&search, &(engine->config), rules, plies_left);
+    int scores[MAX_MOVES];
+    fast_root_scores(&search, cells, player, scores);
+    return moves[get_highest_score_position(
+        scores, 
+        num_moves, 
+        &(engine->rng)
+    )];
+}
+
+
+// Get the move of the fast engine for the turn player of a classic game
+Move* get_fast_move(Engine* engine, Board* board) {
+    unsigned char cells[NUM_NODES];
+    get_board_cells(board, cells);
+    int code = select_fast_move(
+        engine, 
+        &(variant_rules[VARIANT_CLASSIC]), 
+        cells, 
+        board->turn_player, 
+        MAX_RECORD_MOVES - board->ply
+    );
+    if (code == -1) {
+        return NULL;
+    }
+    Move* move = (Move*) malloc_tracked(sizeof(Move), memory_moves);
+    *move = decode_move((unsigned char) code);
+    return move;
+}
+
+
+// Root scores of the reference search (calculate_root_children_score)
+// Returns the number of moves
+int get_reference_root_scores(
+    Board* board, 
+    EngineConfig* config, 
+    AdjacencyMatrix* adj_matrix, 
+    int* scores
+) {
+    Move** moves = (Move**) malloc_tracked(
+        sizeof(Move*) * MAX_MOVES, 
+        memory_move_lists
+    );
+    int num_moves = 0;
+    list_valid_moves(board, moves, &num_moves, adj_matrix);
+
+    int computer_id = board->turn_player;
+    int player_id = (computer_id == id_player_1) ? id_player_2 : id_player_1;
+    BoardState* root = create_board_state(NULL);
+    calculate_root_children_score(
+        root, 
+        NULL, 
+        board, 
+        player_id, 
+        computer_id, 
+        config, 
+        moves, 
+        num_moves, 
+        adj_matrix
+    );
+    for (int i = 0; i < num_moves; i++) {
+        scores[i] = root->children[i]->score;
+        free_tracked(moves[i]);
+    }
+    free_tracked(moves);
+    delete_board_state(root);
+    return num_moves;
+}
+
+
+// Compare the root scores of both searches on a position
+// Returns the index of the first different move, MAX_MOVES if the number
+// of moves differs or -1 if the scores are equal
+int compare_root_scores(
+    Board* board, 
+    EngineConfig* config, 
+    AdjacencyMatrix* adj_matrix, 
+    int* reference_scores, 
+    int* fast_scores
+) {
+    FastSearch search;
+    init_fast_search(
+        &search, 
+        config, 
+        &(variant_rules[VARIANT_CLASSIC]), 
+        MAX_RECORD_MOVES - board->ply
+    );
+    int num_reference = get_reference_root_scores(
+        board, 
+        config, 
+        adj_matrix, 
+        reference_scores
+    );
+    unsigned char cells[NUM_NODES];
+    get_board_cells(board, cells);
+    int num_fast = fast_root_scores(
+        &search, 
+        cells, 
+        board->turn_player, 
+        fast_scores
+    );
+    if (num_reference != num_fast) {
+        return MAX_MOVES;
+    }
+    for (int i = 0; i < num_reference; i++) {
+        if (reference_scores[i] != fast_scores[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+// Play random moves from the initial position
+// Returns the number of moves played (the walk stops at a win or when the
+// turn player has no moves)
+int play_random_walk(
+    Board* board, 
+    int num_moves, 
+    Rng* rng, 
+    AdjacencyMatrix* adj_matrix, 
+    unsigned char* walk
+) {
+    set_initial_position(board);
+    board->turn_player = id_player_1;
+    Move* moves[MAX_MOVES];
+    for (int i = 0; i < num_moves; i++) {
+        int count = 0;
+        list_valid_moves(board, moves, &count, adj_matrix);
+        if (count == 0) {
+            return i;
+        }
+        Move move = *(moves[random_below(rng, count)]);
+        for (int j = 0; j < count; j++) {
+            free_tracked(moves[j]);
+        }
+
+        make_move(board, move, adj_matrix);
+        walk[i] = encode_move(move);
+        if (player_is_winner(board)) {
+            // Keep the position before the win
+            set_player(move.origin, board->turn_player, board);
+            set_player(move.destiny, id_empty, board);
+            board->ply--;
+            return i;
+        }
+        board->turn_player = (
+            (board->turn_player == id_player_1) ? id_player_2 : id_player_1
+        );
+    }
+    return num_moves;
+}
+
+
+// Check the fast search against the reference search on random reachable
+// positions and print the speedup
+// The first mismatch is reduced to the earliest position of its random
+// walk and the lowest height that still differ
+// Returns the number of mismatches
+int verify_fast_search(
+    int num_positions, 
+    uint64_t seed, 
+    EngineConfig* config
+) {
+    Board* board = create_board();
+    AdjacencyMatrix* adj_matrix = create_adjacency_matrix(NUM_NODES);
+    Rng rng;
+    seed_rng(&rng, seed);
+
+    EngineConfig search_config = *config;
+    search_config.type = engine_minimax;
+    search_config.reuse_tree = false;
+
+    unsigned char walk[VERIFY_MAX_WALK];
+    int reference_scores[MAX_MOVES];
+    int fast_scores[MAX_MOVES];
+    uint64_t reference_time = 0;
+    uint64_t fast_time = 0;
+    int num_mismatches = 0;
+    for (int n = 0; n < num_positions; n++) {
+        int walk_length = play_random_walk(
+            board, 
+            random_below(&rng, VERIFY_MAX_WALK + 1), 
+            &rng, 
+            adj_matrix, 
+            walk
+        );
+
+        // Time each search on the same position
+        uint64_t start_time = get_thread_cpu_time();
+        int num_reference = get_reference_root_scores(
+            board, 
+            &search_config, 
+            adj_matrix, 
+            reference_scores
+        );
+        uint64_t middle_time = get_thread_cpu_time();
+        FastSearch search;
+        init_fast_search(
+            &search, 
+            &search_config, 
+            &(variant_rules[VARIANT_CLASSIC]), 
+            MAX_RECORD_MOVES - board->ply
+        );
+        unsigned char cells[NUM_NODES];
+        get_board_cells(board, cells);
+        int num_fast = fast_root_scores(
+            &search, 
+            cells, 
+            board->turn_player, 
+            fast_scores
+        );
+        uint64_t end_time = get_thread_cpu_time();
+        reference_time += middle_time - start_time;
+        fast_time += end_time - middle_time;
+
+        bool equal = (num_reference == num_fast);
+        for (int i = 0; i < num_reference && equal; i++) {
+            equal = (reference_scores[i] == fast_scores[i]);
+        }
+        if (equal) {
+            continue;
+        }
+        num_mismatches++;
+        if (num_mismatches > 1) {
+            continue;
+        }
+
+        // Find the earliest position of the walk with a mismatch
+        int length = 0;
+        int difference = -1;
+        for (length = 0; length <= walk_length && difference == -1; length++) {
+            set_initial_position(board);
+            board->turn_player = id_player_1;
+            for (int i = 0; i < length; i++) {
+                make_move(board, decode_move(walk[i]), adj_matrix);
+                board->turn_player = (
+                    (board->turn_player == id_player_1) 
+                    ? id_player_2 : id_player_1
+                );
+            }
+            difference = compare_root_scores(
+                board, 
+                &search_config, 
+                adj_matrix, 
+                reference_scores, 
+                fast_scores
+            );
+        }
+
+        // Find the lowest height with a mismatch on that position
+        EngineConfig reduced_config = search_config;
+        for (int height = 0; height <= search_config.max_height; height++) {
+            reduced_config.max_height = height;
+            difference = compare_root_scores(
+                board, 
+                &reduced_config, 
+                adj_matrix, 
+                reference_scores, 
+                fast_scores
+            );
+            if (difference != -1) {
+                break;
+            }
+        }
+
+        char notation[NOTATION_SIZE + 1];
+        notation[format_position_notation(board, notation)] = '\0';
+        if (difference == MAX_MOVES) {
+            printf(
+                "Divergencia: \"%s\" altura %d: numero de jogadas diferente\n",
+                notation, 
+                reduced_config.max_height
+            );
+        } else {
+            printf(
+                "Divergencia: \"%s\" altura %d jogada %d: "
+                "referencia %d, rapida %d\n",
+                notation, 
+                reduced_config.max_height, 
+                difference,
+                reference_scores[difference], 
+                fast_scores[difference]
+            );
+        }
+    }
+
+    printf(
+        "%d posicoes, altura %d, %d divergencias\n", 
+        num_positions, 
+        search_config.max_height, 
+        num_mismatches
+    );
+    printf(
+        "Tempo de CPU: referencia %.3f s, rapida %.3f s (%.1fx)\n",
+        reference_time / 1e9, 
+        fast_time / 1e9, 
+        (fast_time > 0) ? (double) reference_time / fast_time : 0.0
+    );
+
+    delete_board(board);
+    delete_adjacency_matrix(adj_matrix);
+    return num_mismatches;
+}
+
+
+// **********
+// Evaluation functions
+
+// Check if a line is the initial row of the player (not a winning line)
+bool is_home_line(int line, int player) {
+    // Lines 0 to BOARD_SIZE - 1 are the rows
+    if (player == id_player_1) {
+        return line == BOARD_SIZE - 1;
+    }
+    return line == 0;
+}
+
+
+// Get the number of pieces of a player missing on its closest winning line
+int get_line_distance(Board* board, int player) {
+    int best_count = 0;
+    for (int line = 0; line < NUM_LINES; line++) {
+        if (is_home_line(line, player)) {
+            continue;
+        }
+        int count = 0;
+        for (int i = 0; i < BOARD_SIZE; i++) {
+            int node = BOARD_LINES[line][i];
+            if (board->table[node / board->size][node % board->size] == player) {
+                count++;
+            }
+        }
+        best_count = max(best_count, count);
+    }
+    return BOARD_SIZE - best_count;
+}
+
+
+// Check if a position is a draw because of the turn limit: no moves are
+// left or no player can complete a line before the limit
+// Each move brings at most one piece to a line, so the turn player wins at
+// the earliest on move 2 * distance - 1 and the other on move 2 * distance
+bool is_turn_limit_draw(int turn_distance, int other_distance, int plies_left) {
+    return plies_left <= 0 || (
+        2 * turn_distance - 1 > plies_left 
+        && 2 * other_distance > plies_left
+    );
+}
+
+
+// Count the valid moves of a player without allocating them
+// Same rules as list_valid_moves: a piece moves to an empty neighbor
+int count_valid_moves(Board* board, int player, AdjacencyMatrix* adj_matrix) {
+    int count = 0;
+    for (int node = 0; node < NUM_NODES; node++) {
+        if (board->table[node / board->size][node % board->size] != player) {
+            continue;
+        }
+        for (int other = 0; other < NUM_NODES; other++) {
+            int cell = board->table[other / board->size][other % board->size];
+            if (cell == id_empty && connected(adj_matrix, node, other)) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+
+// Calculate the evaluation features of a player
+void get_evaluation_features(
+    Board* board, 
+    int player, 
+    AdjacencyMatrix* adj_matrix, 
+    int* features
+) {
+    // Mobility
+    features[feature_mobility] = count_valid_moves(board, player, adj_matrix);
+
+    // Centre control
+    int center = board->table[BOARD_SIZE / 2][BOARD_SIZE / 2];
+    features[feature_center] = (center == player) ? 1 : 0;
+
+    // Threats (two pieces on a winning line with the third cell empty) and
+    // distance to a winning line (pieces missing on the closest one)
+    features[feature_threats] = 0;
+    int best_count = 0;
+    for (int line = 0; line < NUM_LINES; line++) {
+        if (is_home_line(line, player)) {
+            continue;
+        }
+        int count = 0;
+        int empty = 0;
+        for (int i = 0; i < BOARD_SIZE; i++) {
+            int node = BOARD_LINES[line][i];
+            int cell = board->table[node / board->size][node % board->size];
+            if (cell == player) {
+                count++;
+            } else if (cell == id_empty) {
+                empty++;
+            }
+        }
+        if (count == BOARD_SIZE - 1 && empty == 1) {
+            features[feature_threats]++;
+        }
+        best_count = max(best_count, count);
+    }
+    features[feature_line_distance] = BOARD_SIZE - best_count;
+    return;
+}
+
+
+// Get the difference of the features between the player and the opponent
+// The line distance is inverted so that a positive value is always good
+void get_feature_differences(
+    Board* board, 
+    int player, 
+    AdjacencyMatrix* adj_matrix, 
+    int* differences
+) {
+    int opponent = (player == id_player_1) ? id_player_2 : id_player_1;
+    int own[NUM_EVAL_FEATURES];
+    int other[NUM_EVAL_FEATURES];
+    get_evaluation_features(board, player, adj_matrix, own);
+    get_evaluation_features(board, opponent, adj_matrix, other);
+
+    for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+        differences[i] = own[i] - other[i];
+    }
+    differences[feature_line_distance] = -differences[feature_line_distance];
+    return;
+}
+
+
+// Static evaluation of a board from the point of view of the player
+// The value is limited to MAX_EVALUATION so a win is always worth more
+int evaluate_board(
+    Board* board, 
+    int player, 
+    int* weights, 
+    AdjacencyMatrix* adj_matrix
+) {
+    int differences[NUM_EVAL_FEATURES];
+    get_feature_differences(board, player, adj_matrix, differences);
+
+    int value = 0;
+    for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+        value += weights[i] * differences[i];
+    }
+    return max(-MAX_EVALUATION, min(MAX_EVALUATION, value));
+}
+
+
+// Read the weights in the format "mobility,center,threats,distance"
+// Returns false if the text is not valid
+bool parse_eval_weights(const char* text, int* weights) {
+    const char* cursor = text;
+    const char* end = text + strlen(text);
+    for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+        if (scan_int(&cursor, end, &(weights[i])) != 1) {
+            return false;
+        }
+        // Skip the separator
+        if (i < NUM_EVAL_FEATURES - 1) {
+            if (cursor == end || *cursor != ',') {
+                return false;
+            }
+            cursor++;
+        }
+    }
+    return (cursor == end);
+}
+
+
+// Index of the table cell of a vector of feature differences
+int get_tuning_cell(int* differences) {
+    int cell = 0;
+    for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+        int range = 2 * TUNING_FEATURE_LIMIT + 1;
+        int value = max(
+            -TUNING_FEATURE_LIMIT, 
+            min(TUNING_FEATURE_LIMIT, differences[i])
+        );
+        cell = cell * range + (value + TUNING_FEATURE_LIMIT);
+    }
+    return cell;
+}
+
+
+// Fit the evaluation weights to the results of recorded games
+// Every position of the games is counted on a table indexed by the feature
+// differences of the turn player, with the points the turn player got at
+// the end of the game. A logistic regression is fitted to the table, so
+// the file is read only once and the memory does not depend on its size.
+// Returns false if the file can not be read
+bool tune_eval_weights(const char* path, int* weights) {
+    GameRecordReader* reader = open_record_reader(path);
+    if (reader == NULL) {
+        return false;
+    }
+
+    // Positions and points (1 for a win, 0.5 for a draw) of each cell
+    int num_cells = 1;
+    for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+        num_cells *= 2 * TUNING_FEATURE_LIMIT + 1;
+    }
+    double* positions = (double*) calloc(num_cells, sizeof(double));
+    double* points = (double*) calloc(num_cells, sizeof(double));
+
+    Board* board = create_board();
+    AdjacencyMatrix* adj_matrix = create_adjacency_matrix(NUM_NODES);
+    GameRecord record;
+    long long num_positions = 0;
+    while (read_game_record(reader, &record)) {
+        if (record.variant != VARIANT_CLASSIC) {
+            continue;
+        }
+        set_initial_position(board);
+        for (int i = 0; i < record.num_moves; i++) {
+            // Make the move
+            Move move = decode_move(record.moves[i]);
+            int mover = get_player(move.origin, board);
+            set_player(move.destiny, mover, board);
+            set_player(move.origin, id_empty, board);
+
+            // Count the position for the next turn player
+            int turn_player = (i % 2 == 0) ? id_player_2 : id_player_1;
+            int differences[NUM_EVAL_FEATURES];
+            get_feature_differences(
+                board, 
+                turn_player, 
+                adj_matrix, 
+                differences
+            );
+            int cell = get_tuning_cell(differences);
+            positions[cell] += 1;
+            if (record.result == turn_player) {
+                points[cell] += 1;
+            } else if (record.result == id_empty) {
+                points[cell] += 0.5;
+            }
+            num_positions++;
+        }
+    }
+    close_record_reader(reader);
+    delete_board(board);
+    delete_adjacency_matrix(adj_matrix);
+
+    if (num_positions == 0) {
+        free(positions);
+        free(points);
+        return false;
+    }
+
+    // Logistic regression by gradient descent over the table
+    double fitted[NUM_EVAL_FEATURES] = {0};
+    for (int step = 0; step < TUNING_STEPS; step++) {
+        double gradient[NUM_EVAL_FEATURES] = {0};
+        for (int cell = 0; cell < num_cells; cell++) {
+            if (positions[cell] == 0) {
+                continue;
+            }
+            // Recover the differences of the cell
+            int differences[NUM_EVAL_FEATURES];
+            int rest = cell;
+            for (int i = NUM_EVAL_FEATURES - 1; i >= 0; i--) {
+                int range = 2 * TUNING_FEATURE_LIMIT + 1;
+                differences[i] = rest % range - TUNING_FEATURE_LIMIT;
+                rest /= range;
+            }
+
+            double z = 0;
+            for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+                z += fitted[i] * differences[i];
+            }
+            double predicted = 1.0 / (1.0 + exp(-z));
+            double error = predicted * positions[cell] - points[cell];
+            for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+                gradient[i] += error * differences[i];
+            }
+        }
+        for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+            fitted[i] -= TUNING_LEARNING_RATE * gradient[i] / num_positions;
+        }
+    }
+
+    // Scale the weights to integers, the largest one becomes
+    // TUNING_WEIGHT_SCALE
+    double largest = 0;
+    for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+        largest = fmax(largest, fabs(fitted[i]));
+    }
+    for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+        weights[i] = (largest > 0) ? (
+            (int) lround(fitted[i] / largest * TUNING_WEIGHT_SCALE)
+        ) : 0;
+    }
+    printf("Posicoes: %lld\n", num_positions);
+    printf(
+        "Coeficientes: %.4f %.4f %.4f %.4f\n", 
+        fitted[feature_mobility], 
+        fitted[feature_center], 
+        fitted[feature_threats], 
+        fitted[feature_line_distance]
+    );
+
+    free(positions);
+    free(points);
+    return true;
+}
+
+
+// **********
+// Proof-number search functions
+
+// Check if the player has a winning line on the cells
+bool cells_have_line(unsigned char* cells, int player) {
+    for (int line = 0; line < NUM_LINES; line++) {
+        if (is_home_line(line, player)) {
+            continue;
+        }
+        bool complete = true;
+        for (int i = 0; i < BOARD_SIZE && complete; i++) {
+            complete = (cells[BOARD_LINES[line][i]] == player);
+        }
+        if (complete) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Entry of a position on the proof table
+int get_proof_entry(unsigned char* cells, int turn_player, int plies_left) {
+    return rank_position(cells, turn_player) * (MAX_RECORD_MOVES + 1) 
+        + plies_left;
+}
+
+
+// Create the search with a bounded number of nodes
+ProofSearch* create_proof_search(
+    int max_nodes, 
+    AdjacencyMatrix* adj_matrix
+) {
+    ProofSearch* search = (ProofSearch*) malloc_tracked(
+        sizeof(ProofSearch), 
+        memory_proof_search
+    );
+    search->max_nodes = max_nodes;
+    search->num_nodes = 0;
+    search->nodes = (ProofNode*) malloc_tracked(
+        sizeof(ProofNode) * max_nodes, 
+        memory_proof_search
+    );
+    search->table = (ProofTableEntry*) calloc_tracked(
+        PROOF_TABLE_SIZE, 
+        sizeof(ProofTableEntry), 
+        memory_proof_search
+    );
+
+    // Neighbor lists of the nodes
+    for (int node = 0; node < NUM_NODES; node++) {
+        search->num_neighbors[node] = 0;
+        for (int other = 0; other < NUM_NODES; other++) {
+            if (connected(adj_matrix, node, other)) {
+                search->neighbors[node][search->num_neighbors[node]] = other;
+                search->num_neighbors[node]++;
+            }
+        }
+    }
+    return search;
+}
+
+
+// Free the search
+void delete_proof_search(ProofSearch* search) {
+    free_tracked(search->nodes);
+    free_tracked(search->table);
+    free_tracked(search);
+    return;
+}
+
+
+// Add a node to the pool
+// Returns -1 if the pool is full
+int add_proof_node(
+    ProofSearch* search, 
+    int parent, 
+    unsigned char* cells, 
+    int turn_player, 
+    int plies_left, 
+    int move
+) {
+    if (search->num_nodes == search->max_nodes) {
+        return -1;
+    }
+    int index = search->num_nodes;
+    search->num_nodes++;
+
+    ProofNode* node = &(search->nodes[index]);
+    memcpy(node->cells, cells, NUM_NODES);
+    node->turn_player = turn_player;
+    node->plies_left = plies_left;
+    node->parent = parent;
+    node->first_child = -1;
+    node->num_children = 0;
+    node->move = move;
+    node->length = 0;
+
+    // Unknown result
+    node->proof = 1;
+    node->disproof = 1;
+
+    // The player that just moved won
+    int last_player = (turn_player == id_player_1) ? id_player_2 : id_player_1;
+    if (move >= 0 && cells_have_line(cells, last_player)) {
+        bool attacker_won = (last_player == search->attacker);
+        node->proof = attacker_won ? 0 : PROOF_INFINITY;
+        node->disproof = attacker_won ? PROOF_INFINITY : 0;
+        return index;
+    }
+
+    // A game that reaches the turn limit is a draw (not a win)
+    if (plies_left == 0) {
+        node->proof = PROOF_INFINITY;
+        node->disproof = 0;
+        return index;
+    }
+
+    // Use the result of a solved transposition
+    ProofTableEntry* entry = &(search->table[
+        get_proof_entry(cells, turn_player, plies_left)
+    ]);
+    if (entry->solved) {
+        node->proof = entry->proven ? 0 : PROOF_INFINITY;
+        node->disproof = entry->proven ? PROOF_INFINITY : 0;
+        node->length = entry->length;
+    }
+    return index;
+}
+
+
+// Add a sum of proof numbers without passing the infinity
+uint32_t add_proof_numbers(uint32_t a, uint32_t b) {
+    return (a + b >= PROOF_INFINITY) ? PROOF_INFINITY : a + b;
+}
+
+
+// Create the children of a node
+// Returns false if the pool is full
+bool expand_proof_node(ProofSearch* search, int index) {
+    ProofNode node = search->nodes[index];
+    int next_player = (
+        (node.turn_player == id_player_1) ? id_player_2 : id_player_1
+    );
+
+    unsigned char cells[NUM_NODES];
+    memcpy(cells, node.cells, NUM_NODES);
+    int first_child = search->num_nodes;
+    int num_children = 0;
+    for (int origin = 0; origin < NUM_NODES; origin++) {
+        if (cells[origin] != node.turn_player) {
+            continue;
+        }
+        for (int i = 0; i < search->num_neighbors[origin]; i++) {
+            int destiny = search->neighbors[origin][i];
+            if (cells[destiny] != id_empty) {
+                continue;
+            }
+            // Make the move and add the child
+            cells[destiny] = node.turn_player;
+            cells[origin] = id_empty;
+            int child = add_proof_node(
+                search, 
+                index, 
+                cells, 
+                next_player, 
+                node.plies_left - 1, 
+                origin * NUM_NODES + destiny
+            );
+            cells[origin] = node.turn_player;
+            cells[destiny] = id_empty;
+
+            if (child == -1) {
+                // Remove the children added so far
+                search->num_nodes = first_child;
+                return false;
+            }
+            num_children++;
+        }
+    }
+
+    ProofNode* expanded = &(search->nodes[index]);
+    expanded->first_child = first_child;
+    expanded->num_children = num_children;
+
+    // A player without moves can not continue the game: it is a draw
+    if (num_children == 0) {
+        expanded->proof = PROOF_INFINITY;
+        expanded->disproof = 0;
+    }
+    return true;
+}
+
+
+// Recalculate the proof and disproof numbers of a node from its children
+void update_proof_node(ProofSearch* search, int index) {
+    ProofNode* node = &(search->nodes[index]);
+    if (node->num_children == 0) {
+        return;
+    }
+
+    bool or_node = (node->turn_player == search->attacker);
+    uint32_t proof = or_node ? PROOF_INFINITY : 0;
+    uint32_t disproof = or_node ? 0 : PROOF_INFINITY;
+    int shortest = MAX_RECORD_MOVES + 1;
+    int longest = 0;
+    for (int i = 0; i < node->num_children; i++) {
+        ProofNode* child = &(search->nodes[node->first_child + i]);
+        if (or_node) {
+            // The attacker needs one winning move
+            proof = (child->proof < proof) ? child->proof : proof;
+            disproof = add_proof_numbers(disproof, child->disproof);
+        } else {
+            // The attacker must win after every defender move
+            proof = add_proof_numbers(proof, child->proof);
+            disproof = (child->disproof < disproof) ? child->disproof : disproof;
+        }
+        if (child->proof == 0) {
+            shortest = min(shortest, child->length);
+            longest = max(longest, child->length);
+        }
+    }
+    node->proof = proof;
+    node->disproof = disproof;
+
+    // The attacker takes the shortest win and the defender the longest one
+    if (proof == 0) {
+        node->length = 1 + (or_node ? shortest : longest);
+    }
+
+    // Store solved nodes on the table
+    if (proof == 0 || disproof == 0) {
+        ProofTableEntry* entry = &(search->table[get_proof_entry(
+            node->cells, 
+            node->turn_player, 
+            node->plies_left
+        )]);
+        entry->solved = true;
+        entry->proven = (proof == 0);
+        entry->length = node->length;
+    }
+    return;
+}
+
+
+// Find the most-proving node: follow the child with the smallest proof
+// number on attacker nodes and the smallest disproof number on defender
+// nodes until an unexpanded node is reached
+int select_most_proving_node(ProofSearch* search) {
+    int index = 0;
+    while (search->nodes[index].num_children > 0) {
+        ProofNode* node = &(search->nodes[index]);
+        bool or_node = (node->turn_player == search->attacker);
+        int best = node->first_child;
+        for (int i = 1; i < node->num_children; i++) {
+            ProofNode* child = &(search->nodes[node->first_child + i]);
+            ProofNode* best_child = &(search->nodes[best]);
+            if (or_node && child->proof < best_child->proof) {
+                best = node->first_child + i;
+            } else if (!or_node && child->disproof < best_child->disproof) {
+                best = node->first_child + i;
+            }
+        }
+        index = best;
+    }
+    return index;
+}
+
+
+// Get the length of a proven position from the table
+// The position is after a move of the other player
+// Returns -1 if the position is not proven
+int get_proof_table_length(
+    ProofSearch* search, 
+    unsigned char* cells, 
+    int turn_player, 
+    int plies_left
+) {
+    int last_player = (turn_player == id_player_1) ? id_player_2 : id_player_1;
+    if (cells_have_line(cells, last_player)) {
+        return (last_player == search->attacker) ? 0 : -1;
+    }
+    if (plies_left == 0) {
+        return -1;
+    }
+    ProofTableEntry* entry = &(search->table[
+        get_proof_entry(cells, turn_player, plies_left)
+    ]);
+    return (entry->solved && entry->proven) ? entry->length : -1;
+}
+
+
+// Add the moves of a proven position to the main line using the table:
+// the attacker plays the shortest win and the defender the longest
+// resistance
+void follow_proof_table(
+    ProofSearch* search, 
+    unsigned char* position, 
+    int turn_player, 
+    int plies_left, 
+    int length, 
+    ProofResult* result
+) {
+    unsigned char cells[NUM_NODES];
+    memcpy(cells, position, NUM_NODES);
+    while (length > 0 && plies_left > 0 
+        && result->num_moves < MAX_RECORD_MOVES) {
+        bool or_node = (turn_player == search->attacker);
+        int next_player = (turn_player == id_player_1) 
+            ? id_player_2 : id_player_1;
+        int best_move = -1;
+        int best_length = -1;
+        for (int origin = 0; origin < NUM_NODES; origin++) {
+            if (cells[origin] != turn_player) {
+                continue;
+            }
+            for (int i = 0; i < search->num_neighbors[origin]; i++) {
+                int destiny = search->neighbors[origin][i];
+                if (cells[destiny] != id_empty) {
+                    continue;
+                }
+                cells[destiny] = turn_player;
+                cells[origin] = id_empty;
+                int child_length = get_proof_table_length(
+                    search, 
+                    cells, 
+                    next_player, 
+                    plies_left - 1
+                );
+                cells[origin] = turn_player;
+                cells[destiny] = id_empty;
+
+                bool better = child_length >= 0 && (best_move == -1 || (
+                    or_node 
+                    ? child_length < best_length 
+                    : child_length > best_length
+                ));
+                if (better) {
+                    best_move = origin * NUM_NODES + destiny;
+                    best_length = child_length;
+                }
+            }
+        }
+        // The table no longer proves the line
+        if (best_move == -1) {
+            return;
+        }
+
+        cells[best_move % NUM_NODES] = turn_player;
+        cells[best_move / NUM_NODES] = id_empty;
+        result->moves[result->num_moves] = (unsigned char) best_move;
+        result->num_moves++;
+        turn_player = next_player;
+        plies_left--;
+        length = best_length;
+    }
+    return;
+}
+
+
+// Prove or disprove a forced win for the turn player of the board
+// The game ends as a draw after plies_left moves
+void prove_position(
+    Board* board, 
+    int plies_left, 
+    int max_nodes, 
+    AdjacencyMatrix* adj_matrix, 
+    ProofResult* result
+) {
+    ProofSearch* search = create_proof_search(max_nodes, adj_matrix);
+    search->attacker = board->turn_player;
+
+    unsigned char cells[NUM_NODES];
+    for (int node = 0; node < NUM_NODES; node++) {
+        cells[node] = board->table[node / board->size][node % board->size];
+    }
+    add_proof_node(search, -1, cells, board->turn_player, plies_left, -1);
+
+    // Expand the most-proving node until the root is solved
+    bool pool_full = false;
+    while (search->nodes[0].proof != 0 && search->nodes[0].disproof != 0 
+        && !pool_full) {
+        int index = select_most_proving_node(search);
+        pool_full = !expand_proof_node(search, index);
+
+        // Update the ancestors
+        while (index != -1 && !pool_full) {
+            update_proof_node(search, index);
+            index = search->nodes[index].parent;
+        }
+    }
+
+    result->nodes = search->num_nodes;
+    result->num_moves = 0;
+    result->length = 0;
+    if (search->nodes[0].proof == 0) {
+        result->status = proof_proven;
+        result->length = search->nodes[0].length;
+
+        // Follow the proof: the attacker plays the shortest win and the
+        // defender the longest resistance
+        int index = 0;
+        while (search->nodes[index].num_children > 0 
+            && search->nodes[index].length > 0) {
+            ProofNode* node = &(search->nodes[index]);
+            bool or_node = (node->turn_player == search->attacker);
+            int best = -1;
+            for (int i = 0; i < node->num_children; i++) {
+                int child = node->first_child + i;
+                if (search->nodes[child].proof != 0) {
+                    continue;
+                }
+                bool better = (best == -1) || (
+                    or_node 
+                    ? search->nodes[child].length < search->nodes[best].length
+                    : search->nodes[child].length > search->nodes[best].length
+                );
+                if (better) {
+                    best = child;
+                }
+            }
+            result->moves[result->num_moves] = search->nodes[best].move;
+            result->num_moves++;
+            index = best;
+        }
+
+        // A node solved from the table has no children: continue the line
+        // with the table
+        ProofNode* last = &(search->nodes[index]);
+        follow_proof_table(
+            search, 
+            last->cells, 
+            last->turn_player, 
+            last->plies_left, 
+            last->length, 
+            result
+        );
+    } else if (search->nodes[0].disproof == 0) {
+        result->status = proof_disproven;
+    } else {
+        result->status = proof_unknown;
+    }
+
+    delete_proof_search(search);
+    return;
+}
+
+
+// Prove a position given in the compact notation and print the result
+void print_proof(const char* notation, int plies_left, int max_nodes) {
+    Board* board = create_board();
+    if (!parse_position_notation(notation, board)) {
+        printf("Posicao invalida: %s\n", notation);
+        delete_board(board);
+        return;
+    }
+
+    AdjacencyMatrix* adj_matrix = create_adjacency_matrix(NUM_NODES);
+    ProofResult result;
+    prove_position(board, plies_left, max_nodes, adj_matrix, &result);
+
+    char symbol = get_symbol_from_player(board->turn_player);
+    if (result.status == proof_proven) {
+        printf(
+            "Vitoria forcada para %c em %d jogadas.\n", 
+            symbol, 
+            result.length
+        );
+        printf("Jogadas:");
+        for (int i = 0; i < result.num_moves; i++) {
+            Move move = decode_move(result.moves[i]);
+            printf(
+                " (%d, %d) -> (%d, %d)", 
+                move.origin.row, move.origin.col, 
+                move.destiny.row, move.destiny.col
+            );
+        }
+        printf("\n");
+    } else if (result.status == proof_disproven) {
+        printf(
+            "Nao ha vitoria forcada para %c em ate %d jogadas.\n", 
+            symbol, 
+            plies_left
+        );
+    } else {
+        printf("Resultado desconhecido: limite de nos atingido.\n");
+    }
+    printf("Nos: %lld\n", result.nodes);
+
+    delete_adjacency_matrix(adj_matrix);
+    delete_board(board);
+    return;
+}
+
+
+// **********
+// Latency statistics functions
+
+// Current time of a monotonic clock in microseconds
+uint64_t get_time_microseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000 + (uint64_t) now.tv_nsec / 1000;
+}
+
+
+// CPU time used by the calling thread in nanoseconds
+uint64_t get_thread_cpu_time() {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+
+// Get the bucket of a value
+// Values below LATENCY_SUB_BUCKETS have their own bucket. Each power of two
+// above it is split in LATENCY_SUB_BUCKETS buckets of the same width
+int get_latency_bucket(uint64_t value) {
+    if (value < LATENCY_SUB_BUCKETS) {
+        return (int) value;
+    }
+    int highest_bit = 63 - __builtin_clzll(value);
+    int shift = highest_bit - LATENCY_SUB_BUCKET_BITS;
+    int sub_bucket = (int) (value >> shift) - LATENCY_SUB_BUCKETS;
+    return (shift + 1) * LATENCY_SUB_BUCKETS + sub_bucket;
+}
+
+
+// Get the largest value of a bucket
+uint64_t get_latency_bucket_value(int bucket) {
+    if (bucket < LATENCY_SUB_BUCKETS) {
+        return (uint64_t) bucket;
+    }
+    int shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    uint64_t sub_bucket = bucket % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+
+// Add a value to the histogram
+void record_latency(LatencyHistogram* histogram, uint64_t value) {
+    histogram->counts[get_latency_bucket(value)]++;
+    histogram->total++;
+    if (value > histogram->max) {
+        histogram->max = value;
+    }
+    return;
+}
+
+
+// Add the values of a histogram to another
+void merge_latency_histogram(
+    LatencyHistogram* histogram, 
+    LatencyHistogram* other
+) {
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        histogram->counts[i] += other->counts[i];
+    }
+    histogram->total += other->total;
+    if (other->max > histogram->max) {
+        histogram->max = other->max;
+    }
+    return;
+}
+
+
+// Get the value below which the given fraction of the values are
+// The result is the largest value of the bucket (limited by the maximum)
+uint64_t get_latency_percentile(LatencyHistogram* histogram, double fraction) {
+    if (histogram->total == 0) {
+        return 0;
+    }
+    uint64_t rank = (uint64_t) ceil(fraction * histogram->total);
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen >= rank && histogram->counts[i] > 0) {
+            uint64_t value = get_latency_bucket_value(i);
+            return (value < histogram->max) ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+
+// Get the phase of the game from the number of moves played
+int get_game_phase(int ply) {
+    if (ply < OPENING_PLIES) {
+        return phase_opening;
+    } else if (ply < MIDDLEGAME_PLIES) {
+        return phase_middlegame;
+    }
+    return phase_endgame;
+}
+
+
+// Print a line with the percentiles of a histogram
+void print_latency_line(const char* label, LatencyHistogram* histogram) {
+    printf(
+        "%-12s %8llu %10llu %10llu %10llu %10llu\n",
+        label,
+        (unsigned long long) histogram->total,
+        (unsigned long long) get_latency_percentile(histogram, 0.50),
+        (unsigned long long) get_latency_percentile(histogram, 0.90),
+        (unsigned long long) get_latency_percentile(histogram, 0.99),
+        (unsigned long long) histogram->max
+    );
+    return;
+}
+
+
+// Print the move latency of the engines by game phase and by ply
+void print_latency_stats(Engine** engines, int num_engines) {
+    // Merge the engines by ply
+    LatencyHistogram* plies = (LatencyHistogram*) calloc(
+        MAX_RECORD_MOVES, 
+        sizeof(LatencyHistogram)
+    );
+    for (int e = 0; e < num_engines; e++) {
+        for (int ply = 0; ply < MAX_RECORD_MOVES; ply++) {
+            merge_latency_histogram(
+                &(plies[ply]), 
+                &(engines[e]->move_latency[ply])
+            );
+        }
+    }
+
+    // Merge the plies by phase
+    LatencyHistogram* phases = (LatencyHistogram*) calloc(
+        NUM_GAME_PHASES + 1, 
+        sizeof(LatencyHistogram)
+    );
+    for (int ply = 0; ply < MAX_RECORD_MOVES; ply++) {
+        merge_latency_histogram(&(phases[get_game_phase(ply)]), &(plies[ply]));
+        merge_latency_histogram(&(phases[NUM_GAME_PHASES]), &(plies[ply]));
+    }
+
+    printf("Latencia das jogadas do computador (microssegundos):\n");
+    printf(
+        "%-12s %8s %10s %10s %10s %10s\n", 
+        "fase", "jogadas", "p50", "p90", "p99", "max"
+    );
+    print_latency_line("abertura", &(phases[phase_opening]));
+    print_latency_line("meio", &(phases[phase_middlegame]));
+    print_latency_line("final", &(phases[phase_endgame]));
+    print_latency_line("total", &(phases[NUM_GAME_PHASES]));
+
+    printf(
+        "%-12s %8s %10s %10s %10s %10s\n", 
+        "jogada", "jogadas", "p50", "p90", "p99", "max"
+    );
+    for (int ply = 0; ply < MAX_RECORD_MOVES; ply++) {
+        if (plies[ply].total > 0) {
+            char label[16];
+            sprintf(label, "%d", ply + 1);
+            print_latency_line(label, &(plies[ply]));
+        }
+    }
+
+    free(plies);
+    free(phases);
+    return;
+}
+
+
+// **********
+// Memory accounting functions
+// The engine allocations go through malloc_tracked and free_tracked. The
+// size and the category of each block are kept in a header before it, and
+// the bytes in use are counted by thread (for the usage of each computer
+// move) and, with memory_accounting, by category (shared by all threads)
+
+// Add (or subtract) a block to the counters of the thread and, if shared,
+// to the counters of a category
+void add_memory_usage(MemoryCategory category, long long bytes, bool shared) {
+    int accounts[2] = {category, NUM_MEMORY_CATEGORIES};
+    for (int i = 0; i < 2 && shared; i++) {
+        MemoryAccount* account = &(memory_accounts[accounts[i]]);
+        long long current = __atomic_add_fetch(
+            &(account->bytes), 
+            bytes, 
+            __ATOMIC_RELAXED
+        );
+        if (bytes > 0) {
+            __atomic_add_fetch(&(account->allocations), 1, __ATOMIC_RELAXED);
+            long long peak = __atomic_load_n(
+                &(account->peak_bytes), 
+                __ATOMIC_RELAXED
+            );
+            while (current > peak && !__atomic_compare_exchange_n(
+                    &(account->peak_bytes), 
+                    &peak, 
+                    current, 
+                    true, 
+                    __ATOMIC_RELAXED, 
+                    __ATOMIC_RELAXED)) {
+            }
+        }
+    }
+
+    thread_memory_bytes += bytes;
+    if (bytes > 0) {
+        thread_memory_allocations++;
+        thread_memory_peak = max_long(thread_memory_peak, thread_memory_bytes);
+    }
+    return;
+}
+
+
+// Allocate a block of a category
+void* malloc_tracked(size_t size, MemoryCategory category) {
+    MemoryHeader* header = (MemoryHeader*) malloc(sizeof(MemoryHeader) + size);
+    header->size = size;
+    header->category = category;
+    header->shared = memory_accounting;
+    add_memory_usage(category, (long long) size, header->shared);
+    return header + 1;
+}
+
+
+// Allocate a block of a category filled with zeros
+void* calloc_tracked(size_t count, size_t size, MemoryCategory category) {
+    void* block = malloc_tracked(count * size, category);
+    memset(block, 0, count * size);
+    return block;
+}
+
+
+// Free a block of malloc_tracked
+void free_tracked(void* block) {
+    if (block == NULL) {
+        return;
+    }
+    MemoryHeader* header = ((MemoryHeader*) block) - 1;
+    add_memory_usage(
+        (MemoryCategory) header->category, 
+        -(long long) header->size, 
+        header->shared
+    );
+    free(header);
+    return;
+}
+
+
+// Start counting the memory of a computer move on this thread
+void begin_memory_window(MemoryWindow* window) {
+    window->start_bytes = thread_memory_bytes;
+    window->start_allocations = thread_memory_allocations;
+    thread_memory_peak = thread_memory_bytes;
+    return;
+}
+
+
+// Store the peak bytes and the allocations of the move on the engine
+void end_memory_window(MemoryWindow* window, Engine* engine) {
+    record_latency(
+        &(engine->move_memory), 
+        (uint64_t) max_long(thread_memory_peak - window->start_bytes, 0)
+    );
+    record_latency(
+        &(engine->move_allocations), 
+        (uint64_t) (thread_memory_allocations - window->start_allocations)
+    );
+    return;
+}
+
+
+// Print the memory in use by category and the memory of each move
+void print_memory_stats(Engine** engines, int num_engines) {
+    printf("Memoria do computador (bytes):\n");
+    printf(
+        "%-20s %12s %12s %12s\n", 
+        "categoria", "em uso", "pico", "alocacoes"
+    );
+    for (int i = 0; i <= NUM_MEMORY_CATEGORIES; i++) {
+        MemoryAccount* account = &(memory_accounts[i]);
+        printf(
+            "%-20s %12lld %12lld %12lld\n", 
+            MEMORY_CATEGORY_NAMES[i], 
+            __atomic_load_n(&(account->bytes), __ATOMIC_RELAXED), 
+            __atomic_load_n(&(account->peak_bytes), __ATOMIC_RELAXED), 
+            __atomic_load_n(&(account->allocations), __ATOMIC_RELAXED)
+        );
+    }
+
+    LatencyHistogram memory;
+    LatencyHistogram allocations;
+    memset(&memory, 0, sizeof(memory));
+    memset(&allocations, 0, sizeof(allocations));
+    for (int e = 0; e < num_engines; e++) {
+        merge_latency_histogram(&memory, &(engines[e]->move_memory));
+        merge_latency_histogram(&allocations, &(engines[e]->move_allocations));
+    }
+    printf("Memoria por jogada do computador:\n");
+    printf(
+        "%-12s %8s %10s %10s %10s %10s\n", 
+        "", "jogadas", "p50", "p90", "p99", "max"
+    );
+    print_latency_line("pico (bytes)", &memory);
+    print_latency_line("alocacoes", &allocations);
+    return;
+}
+
+
+// **********
+// Trace functions
+
+// Current time of a monotonic clock in nanoseconds
+uint64_t get_time_nanoseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
+
+// Start recording the trace events
+// The events are kept in memory until write_trace is called
+void start_trace(const char* path, int max_height) {
+    pthread_mutex_init(&(tracer.mutex), NULL);
+    tracer.path = path;
+    tracer.max_height = max_height;
+    tracer.buffers = NULL;
+    tracer.num_threads = 0;
+    tracer.start_time = get_time_nanoseconds();
+    tracer.enabled = true;
+    return;
+}
+
+
+// Get the trace buffer of the calling thread (created on the first event)
+TraceBuffer* get_trace_buffer() {
+    if (thread_trace_buffer != NULL) {
+        return thread_trace_buffer;
+    }
+    TraceBuffer* buffer = (TraceBuffer*) malloc(sizeof(TraceBuffer));
+    buffer->events = (TraceEvent*) malloc(
+        sizeof(TraceEvent) * TRACE_INITIAL_EVENTS
+    );
+    buffer->num_events = 0;
+    buffer->capacity = TRACE_INITIAL_EVENTS;
+    buffer->dropped = 0;
+
+    // Buffers are kept on a list until the trace is written, so the events
+    // of finished threads are not lost
+    pthread_mutex_lock(&(tracer.mutex));
+    buffer->thread_id = ++tracer.num_threads;
+    buffer->next = tracer.buffers;
+    tracer.buffers = buffer;
+    pthread_mutex_unlock(&(tracer.mutex));
+
+    thread_trace_buffer = buffer;
+    return buffer;
+}
+
+
+// Get the start time of a span at the given height of the search tree
+// Returns 0 if the span is not traced
+uint64_t begin_trace_span(int height) {
+    if (!tracer.enabled || height > tracer.max_height) {
+        return 0;
+    }
+    return get_time_nanoseconds();
+}
+
+
+// Record a span started by begin_trace_span
+// The value is an argument shown with the event (e.g. the number of moves)
+void end_trace_span(
+    const char* name, 
+    uint64_t start_time, 
+    int height, 
+    int value
+) {
+    if (start_time == 0) {
+        return;
+    }
+    uint64_t end_time = get_time_nanoseconds();
+    TraceBuffer* buffer = get_trace_buffer();
+
+    // Grow the buffer up to the event limit
+    if (buffer->num_events == buffer->capacity) {
+        if (buffer->capacity >= TRACE_MAX_EVENTS) {
+            buffer->dropped++;
+            return;
+        }
+        buffer->capacity *= 2;
+        buffer->events = (TraceEvent*) realloc(
+            buffer->events, 
+            sizeof(TraceEvent) * buffer->capacity
+        );
+    }
+
+    TraceEvent* event = &(buffer->events[buffer->num_events++]);
+    event->name = name;
+    event->start = start_time - tracer.start_time;
+    event->duration = end_time - start_time;
+    event->height = height;
+    event->value = value;
+    return;
+}
+
+
+// Write the recorded events as Chrome trace JSON and free the buffers
+// Spans are complete events ("ph":"X"), timestamps are in microseconds
+bool write_trace() {
+    if (!tracer.enabled) {
+        return true;
+    }
+    tracer.enabled = false;
+
+    FILE* file = fopen(tracer.path, "w");
+    if (file != NULL) {
+        setvbuf(file, NULL, _IOFBF, TRACE_WRITE_BUFFER_SIZE);
+        fprintf(file, "{\"traceEvents\":[\n");
+        fprintf(
+            file, 
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,"
+            "\"args\":{\"name\":\"pe_de_galinha\"}}"
+        );
+    }
+
+    long long dropped = 0;
+    TraceBuffer* buffer = tracer.buffers;
+    while (buffer != NULL) {
+        if (file != NULL) {
+            fprintf(
+                file, 
+                ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                buffer->thread_id, 
+                buffer->thread_id
+            );
+            for (int i = 0; i < buffer->num_events; i++) {
+                TraceEvent* event = &(buffer->events[i]);
+                fprintf(
+                    file,
+                    ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                    "\"ts\":%llu.%03llu,\"dur\":%llu.%03llu,"
+                    "\"args\":{\"height\":%d,\"value\":%d}}",
+                    event->name,
+                    buffer->thread_id,
+                    (unsigned long long) (event->start / 1000),
+                    (unsigned long long) (event->start % 1000),
+                    (unsigned long long) (event->duration / 1000),
+                    (unsigned long long) (event->duration % 1000),
+                    event->height,
+                    event->value
+                );
+            }
+        }
+        dropped += buffer->dropped;
+
+        TraceBuffer* next = buffer->next;
+        free(buffer->events);
+        free(buffer);
+        buffer = next;
+    }
+    tracer.buffers = NULL;
+    thread_trace_buffer = NULL;
+
+    if (file == NULL) {
+        printf("Nao foi possivel criar o arquivo %s.\n", tracer.path);
+        return false;
+    }
+    fprintf(
+        file, 
+        "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%lld}}\n",
+        dropped
+    );
+    fclose(file);
+    if (dropped > 0) {
+        printf(
+            "Trace: %lld eventos descartados (limite de %d por thread).\n", 
+            dropped, 
+            TRACE_MAX_EVENTS
+        );
+    }
+    pthread_mutex_destroy(&(tracer.mutex));
+    return true;
+}
+
+
+// **********
+// Tree dump functions
+// The nodes of the minimax searches are written while the search runs, so
+// the tree does not stay in memory. Each record has (little-endian): the
+// number of the node (4 bytes), the number of its parent (4 bytes, 0 for
+// the root of a search), the score for the computer (4 bytes, signed), the
+// move (origin * 9 + destiny, TREE_DUMP_NO_MOVE on the roots), the height
+// and the cutoff reason (1 byte each) and a reserved byte. A node is
+// written after its children, and its number is larger than its parent's.
+
+// Open the dump file and enable the dump
+// Returns false if the file can not be created
+bool start_tree_dump(const char* path) {
+    tree_dump.file = fopen(path, "wb");
+    if (tree_dump.file == NULL) {
+        return false;
+    }
+    unsigned char header[TREE_DUMP_HEADER_SIZE] = {0};
+    memcpy(header, TREE_DUMP_MAGIC, TREE_DUMP_MAGIC_SIZE);
+    header[TREE_DUMP_MAGIC_SIZE] = TREE_DUMP_VERSION;
+    fwrite(header, 1, TREE_DUMP_HEADER_SIZE, tree_dump.file);
+    pthread_mutex_init(&(tree_dump.mutex), NULL);
+    tree_dump.last_id = 0;
+    tree_dump.num_nodes = 0;
+    tree_dump.failed = false;
+    tree_dump.buffers = NULL;
+    tree_dump.enabled = true;
+    return true;
+}
+
+
+// Get the number of a new node
+int get_tree_dump_id() {
+    return __atomic_add_fetch(&(tree_dump.last_id), 1, __ATOMIC_RELAXED);
+}
+
+
+// Add a node to the buffer of the calling thread
+void write_tree_dump_node(
+    int id, 
+    int parent, 
+    int move, 
+    int height, 
+    int score, 
+    CutoffReason reason
+) {
+    TreeDumpBuffer* buffer = thread_tree_dump_buffer;
+    if (buffer == NULL) {
+        // Buffers are kept on a list until the dump is finished, so the
+        // nodes of finished threads are not lost
+        buffer = (TreeDumpBuffer*) malloc(sizeof(TreeDumpBuffer));
+        buffer->used = 0;
+        pthread_mutex_lock(&(tree_dump.mutex));
+        buffer->next = tree_dump.buffers;
+        tree_dump.buffers = buffer;
+        pthread_mutex_unlock(&(tree_dump.mutex));
+        thread_tree_dump_buffer = buffer;
+    }
+    if (buffer->used + TREE_DUMP_RECORD_SIZE > TREE_DUMP_BUFFER_SIZE) {
+        flush_tree_dump_buffer(buffer);
+    }
+
+    unsigned char* out = buffer->data + buffer->used;
+    store_little_endian(out, (uint32_t) id, 4);
+    store_little_endian(out + 4, (uint32_t) parent, 4);
+    store_little_endian(out + 8, (uint32_t) score, 4);
+    out[12] = (unsigned char) move;
+    out[13] = (unsigned char) height;
+    out[14] = (unsigned char) reason;
+    out[15] = 0;
+    buffer->used += TREE_DUMP_RECORD_SIZE;
+    return;
+}
+
+
+// Write the records of a buffer to the file
+void flush_tree_dump_buffer(TreeDumpBuffer* buffer) {
+    pthread_mutex_lock(&(tree_dump.mutex));
+    size_t written = fwrite(buffer->data, 1, buffer->used, tree_dump.file);
+    if (written != (size_t) buffer->used) {
+        tree_dump.failed = true;
+    }
+    tree_dump.num_nodes += buffer->used / TREE_DUMP_RECORD_SIZE;
+    pthread_mutex_unlock(&(tree_dump.mutex));
+    buffer->used = 0;
+    return;
+}
+
+
+// Write the pending records, close the file and free the buffers
+// Returns false if the file could not be written
+bool finish_tree_dump() {
+    if (!tree_dump.enabled) {
+        return true;
+    }
+    tree_dump.enabled = false;
+
+    TreeDumpBuffer* buffer = tree_dump.buffers;
+    while (buffer != NULL) {
+        flush_tree_dump_buffer(buffer);
+        TreeDumpBuffer* next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+    tree_dump.buffers = NULL;
+    thread_tree_dump_buffer = NULL;
+
+    bool written = (fclose(tree_dump.file) == 0) && !tree_dump.failed;
+    if (written) {
+        printf("Arvore de busca: %lld nos gravados.\n", tree_dump.num_nodes);
+    } else {
+        printf("Nao foi possivel gravar a arvore de busca.\n");
+    }
+    pthread_mutex_destroy(&(tree_dump.mutex));
+    return written;
+}
+
+
+// Get the name of a cutoff reason (shown on the DOT conversion)
+const char* get_cutoff_reason_name(CutoffReason reason) {
+    switch (reason) {
+        case cutoff_none:
+            return "";
+        case cutoff_win_found:
+            return "corte: vitoria encontrada";
+        case cutoff_winning_move:
+            return "jogada vencedora";
+        case cutoff_horizon:
+            return "limite da busca";
+        case cutoff_turn_limit:
+            return "limite de jogadas";
+        case cutoff_cached:
+            return "busca anterior";
+        case cutoff_no_moves:
+            return "sem jogadas";
+        default:
+            return "?";
+    }
+}
+
+
+// Read the nodes of a tree dump up to the maximum height
+// Only those nodes are kept, so the memory does not depend on the size of
+// the deeper search
+// Returns the nodes (NULL if the file is not a tree dump)
+TreeDumpNode* read_tree_dump(
+    const char* path, 
+    int max_height, 
+    int* num_nodes
+) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    unsigned char header[TREE_DUMP_HEADER_SIZE];
+    if (fread(header, 1, TREE_DUMP_HEADER_SIZE, file) != TREE_DUMP_HEADER_SIZE 
+        || memcmp(header, TREE_DUMP_MAGIC, TREE_DUMP_MAGIC_SIZE) != 0 
+        || header[TREE_DUMP_MAGIC_SIZE] != TREE_DUMP_VERSION) {
+        fclose(file);
+        return NULL;
+    }
+
+    int capacity = 1024;
+    TreeDumpNode* nodes = (TreeDumpNode*) malloc(
+        sizeof(TreeDumpNode) * capacity
+    );
+    *num_nodes = 0;
+    unsigned char* data = (unsigned char*) malloc(TREE_DUMP_BUFFER_SIZE);
+    size_t size = fread(data, 1, TREE_DUMP_BUFFER_SIZE, file);
+    while (size >= TREE_DUMP_RECORD_SIZE) {
+        for (size_t offset = 0; offset + TREE_DUMP_RECORD_SIZE <= size; 
+            offset += TREE_DUMP_RECORD_SIZE) {
+            unsigned char* in = data + offset;
+            if (in[13] > max_height) {
+                continue;
+            }
+            if (*num_nodes == capacity) {
+                capacity *= 2;
+                nodes = (TreeDumpNode*) realloc(
+                    nodes, 
+                    sizeof(TreeDumpNode) * capacity
+                );
+            }
+            TreeDumpNode* node = &(nodes[(*num_nodes)++]);
+            node->id = (int) load_little_endian(in, 4);
+            node->parent = (int) load_little_endian(in + 4, 4);
+            node->score = (int32_t) load_little_endian(in + 8, 4);
+            node->move = in[12];
+            node->height = in[13];
+            node->reason = min(in[14], NUM_CUTOFF_REASONS);
+            node->shown = false;
+        }
+        size = fread(data, 1, TREE_DUMP_BUFFER_SIZE, file);
+    }
+    free(data);
+    fclose(file);
+    return nodes;
+}
+
+
+// Order the nodes by number
+int compare_tree_dump_ids(const void* a, const void* b) {
+    const TreeDumpNode* node_a = (const TreeDumpNode*) a;
+    const TreeDumpNode* node_b = (const TreeDumpNode*) b;
+    return (node_a->id > node_b->id) - (node_a->id < node_b->id);
+}
+
+
+// Order the nodes by parent and then from the best for the player that
+// moves on the parent (the computer moves on the even heights)
+int compare_tree_dump_siblings(const void* a, const void* b) {
+    const TreeDumpNode* node_a = *(const TreeDumpNode* const*) a;
+    const TreeDumpNode* node_b = *(const TreeDumpNode* const*) b;
+    if (node_a->parent != node_b->parent) {
+        return (node_a->parent > node_b->parent) 
+            - (node_a->parent < node_b->parent);
+    }
+    // The height of the parent is the height of the children minus 1
+    int sign = (node_a->height % 2 == 1) ? -1 : 1;
+    return sign * ((node_a->score > node_b->score) 
+        - (node_a->score < node_b->score));
+}
+
+
+// Order the nodes by height and then by number
+int compare_tree_dump_heights(const void* a, const void* b) {
+    const TreeDumpNode* node_a = *(const TreeDumpNode* const*) a;
+    const TreeDumpNode* node_b = *(const TreeDumpNode* const*) b;
+    if (node_a->height != node_b->height) {
+        return (node_a->height > node_b->height) 
+            - (node_a->height < node_b->height);
+    }
+    return (node_a->id > node_b->id) - (node_a->id < node_b->id);
+}
+
+
+// Find a node on nodes ordered by number
+// Returns its index or -1 if it is not there
+int find_tree_dump_node(TreeDumpNode* nodes, int num_nodes, int id) {
+    int low = 0;
+    int high = num_nodes - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (nodes[middle].id == id) {
+            return middle;
+        } else if (nodes[middle].id < id) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return -1;
+}
+
+
+// Write a DOT graph with the top branches of a tree dump: the roots of the
+// searches and, on each shown node up to the maximum height, its best top
+// children for the player to move
+// Returns false if the file is not a tree dump
+bool convert_tree_dump_to_dot(
+    const char* path, 
+    FILE* output, 
+    int top, 
+    int max_height
+) {
+    int num_nodes = 0;
+    TreeDumpNode* nodes = read_tree_dump(path, max_height, &num_nodes);
+    if (nodes == NULL) {
+        printf("Arquivo de arvore de busca invalido: %s\n", path);
+        return false;
+    }
+    qsort(nodes, num_nodes, sizeof(TreeDumpNode), compare_tree_dump_ids);
+
+    // Rank of each node among its siblings
+    TreeDumpNode** order = (TreeDumpNode**) malloc(
+        sizeof(TreeDumpNode*) * max(1, num_nodes)
+    );
+    int* ranks = (int*) malloc(sizeof(int) * max(1, num_nodes));
+    for (int i = 0; i < num_nodes; i++) {
+        order[i] = &(nodes[i]);
+    }
+    qsort(order, num_nodes, sizeof(TreeDumpNode*), compare_tree_dump_siblings);
+    for (int i = 0; i < num_nodes; i++) {
+        bool first = (i == 0 || order[i - 1]->parent != order[i]->parent);
+        int rank = first ? 0 : ranks[order[i - 1] - nodes] + 1;
+        ranks[order[i] - nodes] = rank;
+    }
+
+    // Parents are decided before their children
+    qsort(order, num_nodes, sizeof(TreeDumpNode*), compare_tree_dump_heights);
+    fprintf(output, "digraph arvore {\n");
+    fprintf(output, "    node [shape=box, fontname=\"monospace\"];\n");
+    int num_searches = 0;
+    for (int i = 0; i < num_nodes; i++) {
+        TreeDumpNode* node = order[i];
+        if (node->parent == 0) {
+            node->shown = true;
+        } else {
+            int parent = find_tree_dump_node(nodes, num_nodes, node->parent);
+            node->shown = (
+                parent != -1 
+                && nodes[parent].shown 
+                && ranks[node - nodes] < top
+            );
+        }
+        if (!node->shown) {
+            continue;
+        }
+
+        if (node->move == TREE_DUMP_NO_MOVE) {
+            fprintf(
+                output, 
+                "    n%d [label=\"busca %d\\nvalor %d", 
+                node->id, 
+                ++num_searches, 
+                node->score
+            );
+        } else {
+            Move move = decode_move(node->move);
+            fprintf(
+                output, 
+                "    n%d [label=\"(%d, %d) -> (%d, %d)\\nvalor %d", 
+                node->id, 
+                move.origin.row, 
+                move.origin.col, 
+                move.destiny.row, 
+                move.destiny.col, 
+                node->score
+            );
+        }
+        if (node->reason != cutoff_none) {
+            fprintf(
+                output, 
+                "\\n%s", 
+                get_cutoff_reason_name((CutoffReason) node->reason)
+            );
+        }
+        fprintf(output, "\"];\n");
+        if (node->parent != 0) {
+            fprintf(output, "    n%d -> n%d;\n", node->parent, node->id);
+        }
+    }
+    fprintf(output, "}\n");
+
+    free(ranks);
+    free(order);
+    free(nodes);
+    return true;
+}
+
+
+// **********
+// Game record functions
+
+// Encode a move in a single byte (origin node * NUM_NODES + destiny node)
+unsigned char encode_move(Move move) {
+    int origin = convert_position_to_node(move.origin, BOARD_SIZE);
+    int destiny = convert_position_to_node(move.destiny, BOARD_SIZE);
+    return (unsigned char) (origin * NUM_NODES + destiny);
+}
+
+
+// Decode a move stored in a single byte
+Move decode_move(unsigned char code) {
+    Move move;
+    move.origin.row = (code / NUM_NODES) / BOARD_SIZE;
+    move.origin.col = (code / NUM_NODES) % BOARD_SIZE;
+    move.destiny.row = (code % NUM_NODES) / BOARD_SIZE;
+    move.destiny.col = (code % NUM_NODES) % BOARD_SIZE;
+    return move;
+}
+
+
+// Initialize an empty game record
+void init_game_record(GameRecord* record, int variant, uint64_t seed) {
+    record->variant = variant;
+    record->seed = seed;
+    record->num_moves = 0;
+    record->result = id_empty;
+    return;
+}
+
+
+// Append a move to the game record
+void add_move_to_record(GameRecord* record, Move move) {
+    // Games longer than the turn limit are not possible
+    if (record->num_moves >= MAX_RECORD_MOVES) {
+        return;
+    }
+    record->moves[record->num_moves] = encode_move(move);
+    record->num_moves++;
+    return;
+}
+
+
+// Open a record file for appending
+// The file header is written only if the file is empty
+GameRecordWriter* open_record_writer(const char* path) {
+    FILE* file = fopen(path, "ab");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    // Allocate memory for the writer
+    GameRecordWriter* writer = (
+        (GameRecordWriter*) malloc(sizeof(GameRecordWriter))
+    );
+    writer->file = file;
+    writer->used = 0;
+
+    // Write the header on new files
+    fseek(file, 0, SEEK_END);
+    if (ftell(file) == 0) {
+        memcpy(writer->buffer, RECORD_MAGIC, RECORD_MAGIC_SIZE);
+        writer->buffer[RECORD_MAGIC_SIZE] = RECORD_VERSION;
+        writer->used = RECORD_MAGIC_SIZE + 1;
+    }
+
+    return writer;
+}
+
+
+// Write the buffered records to the file
+void flush_record_writer(GameRecordWriter* writer) {
+    if (writer->used > 0) {
+        fwrite(writer->buffer, 1, writer->used, writer->file);
+        writer->used = 0;
+    }
+    fflush(writer->file);
+    return;
+}
+
+
+// Append a game record to the writer buffer
+// The buffer is written to the file only when it is full
+void write_game_record(GameRecordWriter* writer, GameRecord* record) {
+    int record_size = RECORD_HEADER_SIZE + record->num_moves + 1;
+    if (writer->used + record_size > RECORD_BUFFER_SIZE) {
+        flush_record_writer(writer);
+    }
+
+    unsigned char* out = writer->buffer + writer->used;
+    // Variant
+    out[0] = (unsigned char) record->variant;
+    // Seed (little-endian)
+    for (int i = 0; i < 8; i++) {
+        out[1 + i] = (unsigned char) (record->seed >> (8 * i));
+    }
+    // Moves
+    out[9] = (unsigned char) record->num_moves;
+    memcpy(out + RECORD_HEADER_SIZE, record->moves, record->num_moves);
+    // Result
+    out[RECORD_HEADER_SIZE + record->num_moves] = (
+        (unsigned char) record->result
+    );
+
+    writer->used += record_size;
+    return;
+}
+
+
+// Flush the pending records and free the writer
+void close_record_writer(GameRecordWriter* writer) {
+    flush_record_writer(writer);
+    fclose(writer->file);
+    free(writer);
+    return;
+}
+
+
+// Open a record file for reading
+// Returns NULL if the file can not be opened or is not a record file
+GameRecordReader* open_record_reader(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    // Allocate memory for the reader
+    GameRecordReader* reader = (
+        (GameRecordReader*) malloc(sizeof(GameRecordReader))
+    );
+    reader->file = file;
+    reader->used = 0;
+    reader->position = 0;
+
+    // Check the file header
+    bool valid = fill_record_reader(reader, RECORD_MAGIC_SIZE + 1);
+    valid = valid && (
+        memcmp(reader->buffer, RECORD_MAGIC, RECORD_MAGIC_SIZE) == 0
+        && reader->buffer[RECORD_MAGIC_SIZE] == RECORD_VERSION
+    );
+    if (!valid) {
+        close_record_reader(reader);
+        return NULL;
+    }
+    reader->position = RECORD_MAGIC_SIZE + 1;
+
+    return reader;
+}
+
+
+// Make sure there are at least "needed" unread bytes in the buffer
+// Returns false if the file ends before that
+bool fill_record_reader(GameRecordReader* reader, int needed) {
+    int available = reader->used - reader->position;
+    if (available >= needed) {
+        return true;
+    }
+
+    // Move the unread bytes to the start of the buffer and read more
+    memmove(reader->buffer, reader->buffer + reader->position, available);
+    reader->used = available;
+    reader->position = 0;
+    reader->used += fread(
+        reader->buffer + reader->used,
+        1,
+        RECORD_BUFFER_SIZE - reader->used,
+        reader->file
+    );
+
+    return (reader->used >= needed);
+}
+
+
+// Read the next record of the file
+// Returns false at the end of the file (or on a truncated record)
+bool read_game_record(GameRecordReader* reader, GameRecord* record) {
+    if (!fill_record_reader(reader, RECORD_HEADER_SIZE)) {
+        return false;
+    }
+
+    unsigned char* in = reader->buffer + reader->position;
+    int num_moves = in[9];
+    if (num_moves > MAX_RECORD_MOVES) {
+        return false;
+    }
+    // The whole record must be on the buffer
+    if (!fill_record_reader(reader, RECORD_HEADER_SIZE + num_moves + 1)) {
+        return false;
+    }
+    in = reader->buffer + reader->position;
+
+    record->variant = in[0];
+    record->seed = 0;
+    for (int i = 0; i < 8; i++) {
+        record->seed |= ((uint64_t) in[1 + i]) << (8 * i);
+    }
+    record->num_moves = num_moves;
+    memcpy(record->moves, in + RECORD_HEADER_SIZE, num_moves);
+    record->result = in[RECORD_HEADER_SIZE + num_moves];
+
+    reader->position += RECORD_HEADER_SIZE + num_moves + 1;
+    return true;
+}
+
+
+// Free the reader
+void close_record_reader(GameRecordReader* reader) {
+    fclose(reader->file);
+    free(reader);
+    return;
+}
+
+
+// Print the statistics of a record file
+// The records are streamed, so the file can be of any size
+void print_records_summary(const char* path) {
+    GameRecordReader* reader = open_record_reader(path);
+    if (reader == NULL) {
+        printf("Nao foi possivel ler o arquivo de partidas %s.\n", path);
+        return;
+    }
+
+    // Count the results and the number of moves
+    long long num_games = 0;
+    long long num_moves = 0;
+    long long wins[3] = {0, 0, 0};
+    GameRecord record;
+    while (read_game_record(reader, &record)) {
+        num_games++;
+        num_moves += record.num_moves;
+        if (record.result >= id_player_1 && record.result <= id_empty) {
+            wins[record.result]++;
+        }
+    }
+    close_record_reader(reader);
+
+    printf("Partidas: %lld\n", num_games);
+    printf("Vitorias de %c: %lld\n", PLAYER_1, wins[id_player_1]);
+    printf("Vitorias de %c: %lld\n", PLAYER_2, wins[id_player_2]);
+    printf("Empates: %lld\n", wins[id_empty]);
+    if (num_games > 0) {
+        printf(
+            "Media de jogadas por partida: %.2f\n", 
+            (double) num_moves / num_games
+        );
+    }
+    return;
+}
+
+
+// **********
+// Game database functions
+// The index of a record file has, for each position (by rank_position),
+// the list of the games that passed through it: the game number (as the
+// difference from the previous entry, in a varint), the ply of the
+// position, the next move (INDEX_NO_MOVE at the end of the game) and the
+// result. A directory with the place of each list and the result counts
+// of each position comes before the lists
+
+// Get the rank of the position before each move of a classic game and
+// after the last move
+// Returns the number of positions (0 for the other variants or a game
+// with an invalid move)
+int get_game_position_ranks(GameRecord* record, int* ranks) {
+    if (record->variant != VARIANT_CLASSIC) {
+        return 0;
+    }
+    unsigned char cells[NUM_NODES];
+    memcpy(cells, variant_rules[VARIANT_CLASSIC].start, NUM_NODES);
+    for (int ply = 0; ply <= record->num_moves; ply++) {
+        int turn_player = (ply % 2 == 0) ? id_player_1 : id_player_2;
+        ranks[ply] = rank_position(cells, turn_player);
+        if (ranks[ply] == -1) {
+            return 0;
+        }
+        if (ply < record->num_moves) {
+            int move = record->moves[ply];
+            if (move >= NUM_NODES * NUM_NODES 
+                || cells[move / NUM_NODES] != turn_player 
+                || cells[move % NUM_NODES] != id_empty) {
+                return 0;
+            }
+            apply_encoded_move(cells, move, turn_player);
+        }
+    }
+    return record->num_moves + 1;
+}
+
+
+// Write a number as a varint (7 bits per byte, lowest bits first)
+// Returns the number of bytes
+int write_varint(unsigned char* out, uint64_t value) {
+    int length = 0;
+    while (value >= 0x80) {
+        out[length++] = (unsigned char) (value | 0x80);
+        value >>= 7;
+    }
+    out[length++] = (unsigned char) value;
+    return length;
+}
+
+
+// Read a varint
+// Returns the number of bytes (0 if the number does not end before end)
+int read_varint(
+    const unsigned char* in, 
+    const unsigned char* end, 
+    uint64_t* value
+) {
+    *value = 0;
+    for (int length = 0; in + length < end && length < 10; length++) {
+        *value |= (uint64_t) (in[length] & 0x7f) << (7 * length);
+        if ((in[length] & 0x80) == 0) {
+            return length + 1;
+        }
+    }
+    return 0;
+}
+
+
+// Add the positions of a game to the directory (first pass) or write its
+// entries on the lists (second pass, when data is not NULL)
+// Returns false if an entry does not fit on the list sized by the first
+// pass (the records changed between the passes)
+bool index_game(
+    IndexKeyEntry* directory, 
+    int64_t* last_game, 
+    uint64_t* cursors, 
+    unsigned char* data, 
+    GameRecord* record, 
+    int64_t game
+) {
+    int ranks[MAX_RECORD_MOVES + 1];
+    int num_positions = get_game_position_ranks(record, ranks);
+    int result = min(max(record->result, id_player_1), id_empty);
+    for (int ply = 0; ply < num_positions; ply++) {
+        int rank = ranks[ply];
+        unsigned char entry[INDEX_MAX_ENTRY_SIZE];
+        int length = write_varint(entry, game - last_game[rank]);
+        entry[length++] = (unsigned char) ply;
+        entry[length++] = (ply < record->num_moves) 
+            ? record->moves[ply] : INDEX_NO_MOVE;
+        entry[length++] = (unsigned char) result;
+
+        if (data == NULL) {
+            IndexKeyEntry* key = &(directory[rank]);
+            key->size += length;
+            key->num_entries++;
+            if (last_game[rank] != game) {
+                key->num_games++;
+                key->results[result]++;
+            }
+        } else {
+            uint64_t list_end = directory[rank].offset + directory[rank].size;
+            if (cursors[rank] + length > list_end) {
+                return false;
+            }
+            memcpy(data + cursors[rank], entry, length);
+            cursors[rank] += length;
+        }
+        last_game[rank] = game;
+    }
+    return true;
+}
+
+
+// Write a directory entry in little-endian order
+void write_index_key_entry(unsigned char* out, IndexKeyEntry* key) {
+    store_little_endian(out, key->offset, 8);
+    store_little_endian(out + 8, key->size, 4);
+    store_little_endian(out + 12, key->num_entries, 4);
+    for (int i = 0; i < 3; i++) {
+        store_little_endian(out + 16 + 4 * i, key->results[i], 4);
+    }
+    store_little_endian(out + 28, key->num_games, 4);
+    return;
+}
+
+
+// Read a directory entry of write_index_key_entry
+void read_index_key_entry(const unsigned char* in, IndexKeyEntry* key) {
+    key->offset = load_little_endian(in, 8);
+    key->size = (uint32_t) load_little_endian(in + 8, 4);
+    key->num_entries = (uint32_t) load_little_endian(in + 12, 4);
+    for (int i = 0; i < 3; i++) {
+        key->results[i] = (uint32_t) load_little_endian(in + 16 + 4 * i, 4);
+    }
+    key->num_games = (uint32_t) load_little_endian(in + 28, 4);
+    return;
+}
+
+
+// Build the index of a record file (written to path + INDEX_SUFFIX)
+// The records are read twice, so the memory does not depend on the
+// number of games: the first pass sizes the lists and the second one
+// writes them on the memory-mapped index. The second pass stops at the
+// games of the first one (games appended meanwhile are not indexed)
+// Returns false if a file can not be read or written, or if the records
+// changed between the passes
+bool build_game_index(const char* path) {
+    IndexKeyEntry* directory = (IndexKeyEntry*) calloc(
+        NUM_POSITION_INDICES, 
+        sizeof(IndexKeyEntry)
+    );
+    int64_t* last_game = (int64_t*) malloc(
+        sizeof(int64_t) * NUM_POSITION_INDICES
+    );
+    uint64_t* cursors = (uint64_t*) malloc(
+        sizeof(uint64_t) * NUM_POSITION_INDICES
+    );
+    char* index_path = (char*) malloc(strlen(path) + strlen(INDEX_SUFFIX) + 1);
+    sprintf(index_path, "%s%s", path, INDEX_SUFFIX);
+
+    bool success = false;
+    int64_t num_games = 0;
+    int64_t num_indexed_games = 0;
+    unsigned char* data = NULL;
+    size_t size = 0;
+    int fd = -1;
+    for (int pass = 0; pass < 2; pass++) {
+        GameRecordReader* reader = open_record_reader(path);
+        if (reader == NULL) {
+            printf("Nao foi possivel ler o arquivo de partidas %s.\n", path);
+            goto cleanup;
+        }
+        for (int i = 0; i < NUM_POSITION_INDICES; i++) {
+            last_game[i] = -1;
+        }
+
+        GameRecord record;
+        num_games = 0;
+        bool fits = true;
+        while (fits && (pass == 0 || num_games < num_indexed_games) 
+            && read_game_record(reader, &record)) {
+            fits = index_game(
+                directory, 
+                last_game, 
+                cursors, 
+                (pass == 0) ? NULL : data, 
+                &record, 
+                num_games
+            );
+            num_games++;
+        }
+        close_record_reader(reader);
+        if (!fits || (pass == 1 && num_games != num_indexed_games)) {
+            printf("O arquivo de partidas %s mudou durante a indexacao.\n", path);
+            goto cleanup;
+        }
+
+        if (pass == 0) {
+            num_indexed_games = num_games;
+            // Place the lists after the directory
+            uint64_t offset = INDEX_HEADER_SIZE 
+                + (uint64_t) INDEX_KEY_ENTRY_SIZE * NUM_POSITION_INDICES;
+            for (int i = 0; i < NUM_POSITION_INDICES; i++) {
+                directory[i].offset = offset;
+                cursors[i] = offset;
+                offset += directory[i].size;
+            }
+            size = offset;
+
+            // Create the index with its final size and map it
+            fd = open(index_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd == -1 || ftruncate(fd, size) != 0) {
+                printf("Nao foi possivel criar o arquivo %s.\n", index_path);
+                goto cleanup;
+            }
+            data = (unsigned char*) mmap(
+                NULL, 
+                size, 
+                PROT_READ | PROT_WRITE, 
+                MAP_SHARED, 
+                fd, 
+                0
+            );
+            if (data == MAP_FAILED) {
+                data = NULL;
+                printf("Nao foi possivel criar o arquivo %s.\n", index_path);
+                goto cleanup;
+            }
+        }
+    }
+
+    // Header and directory
+    memcpy(data, INDEX_MAGIC, INDEX_MAGIC_SIZE);
+    data[INDEX_MAGIC_SIZE] = INDEX_VERSION;
+    store_little_endian(data + INDEX_MAGIC_SIZE + 4, num_games, 4);
+    store_little_endian(data + INDEX_MAGIC_SIZE + 8, NUM_POSITION_INDICES, 4);
+    for (int i = 0; i < NUM_POSITION_INDICES; i++) {
+        write_index_key_entry(
+            data + INDEX_HEADER_SIZE + INDEX_KEY_ENTRY_SIZE * i, 
+            &(directory[i])
+        );
+    }
+
+    int num_positions = 0;
+    for (int i = 0; i < NUM_POSITION_INDICES; i++) {
+        num_positions += (directory[i].num_entries > 0);
+    }
+    printf(
+        "Indice %s: %lld partidas, %d posicoes, %zu bytes\n", 
+        index_path, 
+        (long long) num_games, 
+        num_positions, 
+        size
+    );
+    success = true;
+
+cleanup:
+    if (data != NULL) {
+        munmap(data, size);
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+    free(index_path);
+    free(cursors);
+    free(last_game);
+    free(directory);
+    return success;
+}
+
+
+// Print the games of the index that passed through a position, with the
+// results after each next move
+// Returns false if the index or the position is not valid
+bool query_game_index(const char* index_path, const char* notation) {
+    Board* board = create_board();
+    bool valid = parse_position_notation(notation, board);
+    unsigned char cells[NUM_NODES];
+    get_board_cells(board, cells);
+    int rank = valid ? rank_position(cells, board->turn_player) : -1;
+    delete_board(board);
+    if (rank == -1) {
+        printf("Posicao invalida: %s\n", notation);
+        return false;
+    }
+
+    // Map the index
+    int fd = open(index_path, O_RDONLY);
+    struct stat file_stat;
+    if (fd == -1 || fstat(fd, &file_stat) != 0) {
+        printf("Nao foi possivel ler o indice %s.\n", index_path);
+        if (fd != -1) {
+            close(fd);
+        }
+        return false;
+    }
+    size_t size = file_stat.st_size;
+    size_t directory_end = INDEX_HEADER_SIZE 
+        + (size_t) INDEX_KEY_ENTRY_SIZE * NUM_POSITION_INDICES;
+    const unsigned char* data = NULL;
+    if (size >= directory_end) {
+        data = (const unsigned char*) mmap(
+            NULL, 
+            size, 
+            PROT_READ, 
+            MAP_PRIVATE, 
+            fd, 
+            0
+        );
+    }
+    close(fd);
+    if (data == NULL || data == MAP_FAILED 
+        || memcmp(data, INDEX_MAGIC, INDEX_MAGIC_SIZE) != 0 
+        || data[INDEX_MAGIC_SIZE] != INDEX_VERSION) {
+        printf("Indice invalido: %s\n", index_path);
+        if (data != NULL && data != MAP_FAILED) {
+            munmap((void*) data, size);
+        }
+        return false;
+    }
+
+    IndexKeyEntry key;
+    read_index_key_entry(
+        data + INDEX_HEADER_SIZE + INDEX_KEY_ENTRY_SIZE * rank, 
+        &key
+    );
+    printf("Posicao: %s\n", notation);
+    printf(
+        "Partidas: %u (%u ocorrencias)\n", 
+        key.num_games, 
+        key.num_entries
+    );
+    printf(
+        "Resultados: vitorias de %c %u, vitorias de %c %u, empates %u\n", 
+        PLAYER_1, key.results[id_player_1], 
+        PLAYER_2, key.results[id_player_2], 
+        key.results[id_empty]
+    );
+
+    // Read the list: results after each next move and the first games
+    uint32_t move_results[INDEX_NO_MOVE + 1][3];
+    memset(move_results, 0, sizeof(move_results));
+    const unsigned char* in = data + key.offset;
+    const unsigned char* end = in + key.size;
+    if (key.offset > size || key.size > size - key.offset) {
+        end = in;
+    }
+    // The first difference of each list is from -1
+    int64_t game = -1;
+    int num_listed = 0;
+    char listed[INDEX_LISTED_GAMES * 24 + 1];
+    int listed_length = 0;
+    while (in < end) {
+        uint64_t delta;
+        int length = read_varint(in, end, &delta);
+        if (length == 0 || end - in < length + 3) {
+            break;
+        }
+        game += delta;
+        int ply = in[length];
+        int move = in[length + 1];
+        int result = min(in[length + 2], id_empty);
+        in += length + 3;
+
+        move_results[min(move, INDEX_NO_MOVE)][result]++;
+        if (num_listed < INDEX_LISTED_GAMES) {
+            listed_length += sprintf(
+                listed + listed_length, 
+                " %lld:%d", 
+                (long long) game, 
+                ply
+            );
+            num_listed++;
+        }
+    }
+    munmap((void*) data, size);
+
+    printf("Jogadas seguintes:\n");
+    for (int move = 0; move <= INDEX_NO_MOVE; move++) {
+        uint32_t* results = move_results[move];
+        uint32_t total = results[0] + results[1] + results[2];
+        if (total == 0) {
+            continue;
+        }
+        if (move == INDEX_NO_MOVE) {
+            printf("  fim da partida");
+        } else {
+            Move decoded = decode_move((unsigned char) move);
+            printf(
+                "  (%d, %d) -> (%d, %d)", 
+                decoded.origin.row, decoded.origin.col, 
+                decoded.destiny.row, decoded.destiny.col
+            );
+        }
+        printf(
+            ": %u, vitorias de %c %u, vitorias de %c %u, empates %u\n", 
+            total, 
+            PLAYER_1, results[id_player_1], 
+            PLAYER_2, results[id_player_2], 
+            results[id_empty]
+        );
+    }
+    if (num_listed > 0) {
+        printf("Partidas (numero:jogada):%s\n", listed);
+    }
+    return true;
+}
+
+
+// **********
+// Position notation functions
+
+// Read a position in the compact notation into the board
+// Returns false if the text is not a valid position
+bool parse_position_notation(const char* text, Board* board) {
+    // Skip leading spaces
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+
+    // Read the cells row by row
+    int count[3] = {0, 0, 0};
+    for (int node = 0; node < NUM_NODES; node++) {
+        char symbol = text[node];
+        if (symbol != PLAYER_1 && symbol != PLAYER_2 && symbol != EMPTY) {
+            return false;
+        }
+        int player = get_player_from_symbol(symbol);
+        board->table[node / board->size][node % board->size] = player;
+        count[player]++;
+    }
+    text += NUM_NODES;
+
+    // Each player must have all their pieces on the board
+    if (count[id_player_1] != NUM_PIECES || count[id_player_2] != NUM_PIECES) {
+        return false;
+    }
+
+    // Read the turn player
+    while (*text == ' ' || *text == '\t') {
+        text++;
+    }
+    if (*text != PLAYER_1 && *text != PLAYER_2) {
+        return false;
+    }
+    board->turn_player = get_player_from_symbol(*text);
+    board->winner = id_empty;
+    board->ply = 0;
+    text++;
+
+    // Only spaces are allowed after the position
+    while (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n') {
+        text++;
+    }
+    return (*text == '\0');
+}
+
+
+// Write the board in the compact notation (without the string terminator)
+// Returns the number of characters written (NOTATION_SIZE)
+int format_position_notation(Board* board, char* out) {
+    for (int node = 0; node < NUM_NODES; node++) {
+        out[node] = get_symbol_from_player(
+            board->table[node / board->size][node % board->size]
+        );
+    }
+    out[NUM_NODES] = ' ';
+    out[NUM_NODES + 1] = get_symbol_from_player(board->turn_player);
+    return NOTATION_SIZE;
+}
+
+
+// **********
+// Thread pool functions
+
+// Number of cores available to the program
+int get_number_of_cores() {
+    long num_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return (num_cores > 0) ? (int) num_cores : 1;
+}
+
+
+// Create a pool with the given number of worker threads
+ThreadPool* create_thread_pool(int num_threads) {
+    ThreadPool* pool = (ThreadPool*) malloc(sizeof(ThreadPool));
+    pool->num_threads = num_threads;
+    pool->task = NULL;
+    pool->context = NULL;
+    pool->num_items = 0;
+    pool->next_item = 0;
+    pool->active_workers = 0;
+    pool->generation = 0;
+    pool->shutdown = false;
+    pthread_mutex_init(&(pool->mutex), NULL);
+    pthread_cond_init(&(pool->work_ready), NULL);
+    pthread_cond_init(&(pool->work_done), NULL);
+
+    // Start the workers
+    pool->threads = (pthread_t*) malloc(sizeof(pthread_t) * num_threads);
+    pool->workers = (
+        (ThreadPoolWorker*) malloc(sizeof(ThreadPoolWorker) * num_threads)
+    );
+    for (int i = 0; i < num_threads; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        pthread_create(
+            &(pool->threads[i]), 
+            NULL, 
+            thread_pool_worker_loop, 
+            &(pool->workers[i])
+        );
+    }
+
+    return pool;
+}
+
+
+// Loop of the worker threads
+// Each worker waits for a job and takes items until there are none left
+void* thread_pool_worker_loop(void* arg) {
+    ThreadPoolWorker* worker = (ThreadPoolWorker*) arg;
+    ThreadPool* pool = worker->pool;
+    int seen_generation = 0;
+
+    pthread_mutex_lock(&(pool->mutex));
+    while (true) {
+        // Wait for a new job
+        while (!pool->shutdown && pool->generation == seen_generation) {
+            pthread_cond_wait(&(pool->work_ready), &(pool->mutex));
+        }
+        if (pool->shutdown) {
+            break;
+        }
+        seen_generation = pool->generation;
+        pthread_mutex_unlock(&(pool->mutex));
+
+        // Run the items of the job
+        int item = __atomic_fetch_add(&(pool->next_item), 1, __ATOMIC_RELAXED);
+        while (item < pool->num_items) {
+            pool->task(pool->context, item, worker->index);
+            item = __atomic_fetch_add(&(pool->next_item), 1, __ATOMIC_RELAXED);
+        }
+
+        // Tell the pool this worker finished
+        pthread_mutex_lock(&(pool->mutex));
+        pool->active_workers--;
+        if (pool->active_workers == 0) {
+            pthread_cond_signal(&(pool->work_done));
+        }
+    }
+    pthread_mutex_unlock(&(pool->mutex));
+
+    return NULL;
+}
+
+
+// Run the task for items 0 to num_items - 1 and wait until all finish
+void thread_pool_run(
+    ThreadPool* pool, 
+    TaskFunction task, 
+    void* context, 
+    int num_items
+) {
+    pthread_mutex_lock(&(pool->mutex));
+    pool->task = task;
+    pool->context = context;
+    pool->num_items = num_items;
+    pool->next_item = 0;
+    pool->active_workers = pool->num_threads;
+    pool->generation++;
+    pthread_cond_broadcast(&(pool->work_ready));
+
+    // Wait for all workers
+    while (pool->active_workers > 0) {
+        pthread_cond_wait(&(pool->work_done), &(pool->mutex));
+    }
+    pthread_mutex_unlock(&(pool->mutex));
+    return;
+}
+
+
+// Stop the workers and free the pool
+void delete_thread_pool(ThreadPool* pool) {
+    pthread_mutex_lock(&(pool->mutex));
+    pool->shutdown = true;
+    pthread_cond_broadcast(&(pool->work_ready));
+    pthread_mutex_unlock(&(pool->mutex));
+
+    for (int i = 0; i < pool->num_threads; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&(pool->mutex));
+    pthread_cond_destroy(&(pool->work_ready));
+    pthread_cond_destroy(&(pool->work_done));
+    free(pool->threads);
+    free(pool->workers);
+    free(pool);
+    return;
+}
+
+
+// **********
+// Analysis functions
+
+// Count the states of a search tree
+long long count_board_states(BoardState* state) {
+    long long count = 1;
+    for (int i = 0; i < state->num_children; i++) {
+        count += count_board_states(state->children[i]);
+    }
+    return count;
+}
+
+
+// Search the best move for the turn player of the board
+void analyze_position(
+    Engine* engine,
+    Board* board, 
+    AdjacencyMatrix* adj_matrix, 
+    AnalysisResult* result
+) {
+    // The turn player is the one searching
+    int computer_id = board->turn_player;
+    int player_id = (computer_id == id_player_1) ? id_player_2 : id_player_1;
+
+    BoardState* root = create_board_state(NULL);
+    Move* best_move = get_best_move(
+        engine,
+        root, 
+        NULL,
+        board, 
+        player_id, 
+        computer_id, 
+        adj_matrix
+    );
+    result->nodes = count_board_states(root);
+
+    if (best_move == NULL) {
+        // No valid moves
+        result->has_move = false;
+        result->score = 0;
+    } else {
+        result->has_move = true;
+        result->move = *best_move;
+        if (root->num_children == 0) {
+            // A winning move was found on the root
+            result->score = SCORE_PER_HEIGHT * (engine->config.max_height + 1);
+        } else {
+            // The chosen move has the highest score
+            result->score = root->children[0]->score;
+            for (int i = 1; i < root->num_children; i++) {
+                result->score = max(result->score, root->children[i]->score);
+            }
+        }
+        free_tracked(best_move);
+    }
+
+    delete_board_state(root);
+    return;
+}
+
+
+// Analyze one line of the batch (thread pool task)
+void analyze_batch_item(void* context, int item, int worker) {
+    AnalysisBatch* batch = (AnalysisBatch*) context;
+    AnalysisResult* result = &(batch->results[item]);
+    Board* board = batch->boards[worker];
+
+    result->valid = !batch->too_long[item] 
+        && parse_position_notation(batch->lines[item], board);
+    result->finished = false;
+    if (result->valid) {
+        unsigned char cells[NUM_NODES];
+        get_board_cells(board, cells);
+        result->finished = cells_have_line(cells, id_player_1) 
+            || cells_have_line(cells, id_player_2);
+    }
+    if (result->valid && !result->finished) {
+        Engine* engine = batch->engines[worker];
+        seed_engine(engine, batch->seed + batch->first_line + item);
+        analyze_position(engine, board, batch->adj_matrix, result);
+    }
+    return;
+}
+
+
+// Write an integer in decimal notation (without the string terminator)
+// Returns the number of characters written
+int append_int(char* out, long long value) {
+    char digits[24];
+    int num_digits = 0;
+    int length = 0;
+
+    unsigned long long magnitude = (unsigned long long) value;
+    if (value < 0) {
+        out[length++] = '-';
+        magnitude = -magnitude;
+    }
+    do {
+        digits[num_digits++] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    while (num_digits > 0) {
+        out[length++] = digits[--num_digits];
+    }
+    return length;
+}
+
+
+// Write the output line of an analyzed position
+// Format: position, best move (origin row and column, destiny row and
+// column), score and number of nodes
+// A position where a player already has a line is written as finished
+// Returns the number of characters written
+int format_analysis_result(
+    const char* line, 
+    AnalysisResult* result, 
+    char* out
+) {
+    int length = 0;
+
+    if (!result->valid) {
+        // Copy the input line (without the line break) and mark it invalid
+        for (int i = 0; line[i] != '\0' && line[i] != '\n' 
+            && line[i] != '\r'; i++) {
+            out[length++] = line[i];
+        }
+        memcpy(out + length, " invalida\n", 10);
+        return length + 10;
+    }
+
+    // Copy the position as written by the user (normalized)
+    for (int i = 0; line[i] != '\0' && length < NOTATION_SIZE; i++) {
+        if (line[i] != ' ' && line[i] != '\t') {
+            if (length == NUM_NODES) {
+                out[length++] = ' ';
+            }
+            out[length++] = line[i];
+        }
+    }
+
+    if (result->finished) {
+        memcpy(out + length, " finalizada\n", 12);
+        return length + 12;
+    }
+
+    if (result->has_move) {
+        out[length++] = ' ';
+        length += append_int(out + length, result->move.origin.row);
+        out[length++] = ' ';
+        length += append_int(out + length, result->move.origin.col);
+        out[length++] = ' ';
+        length += append_int(out + length, result->move.destiny.row);
+        out[length++] = ' ';
+        length += append_int(out + length, result->move.destiny.col);
+    } else {
+        memcpy(out + length, " - - - -", 8);
+        length += 8;
+    }
+    out[length++] = ' ';
+    length += append_int(out + length, result->score);
+    out[length++] = ' ';
+    length += append_int(out + length, result->nodes);
+    out[length++] = '\n';
+
+    return length;
+}
+
+
+// Analyze all positions of the input and write the results in input order
+// The positions are processed in batches, so the memory is bounded
+void analyze_positions(
+    FILE* input, 
+    FILE* output, 
+    int num_threads, 
+    uint64_t seed,
+    EngineConfig* config
+) {
+    AnalysisBatch* batch = (AnalysisBatch*) malloc(sizeof(AnalysisBatch));
+    batch->adj_matrix = create_adjacency_matrix(NUM_NODES);
+    batch->boards = (Board**) malloc(sizeof(Board*) * num_threads);
+    batch->engines = (Engine**) malloc(sizeof(Engine*) * num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        batch->boards[i] = create_board();
+        batch->engines[i] = create_engine(seed, config);
+    }
+    batch->seed = seed;
+    batch->first_line = 0;
+    ThreadPool* pool = create_thread_pool(num_threads);
+    // Invalid lines are copied to the output, so reserve twice the input
+    char* out = (char*) malloc(ANALYSIS_BATCH_SIZE * ANALYSIS_LINE_SIZE * 2);
+
+    bool end_of_input = false;
+    while (!end_of_input) {
+        // Read a batch of lines (empty lines are ignored)
+        int num_lines = 0;
+        while (num_lines < ANALYSIS_BATCH_SIZE && !end_of_input) {
+            char* line = batch->lines[num_lines];
+            if (fgets(line, ANALYSIS_LINE_SIZE, input) == NULL) {
+                end_of_input = true;
+                continue;
+            }
+
+            // Discard the rest of a line longer than the buffer
+            size_t line_length = strlen(line);
+            bool too_long = false;
+            if (line[line_length - 1] != '\n') {
+                int next = fgetc(input);
+                too_long = (next != '\n' && next != EOF);
+                while (next != '\n' && next != EOF) {
+                    next = fgetc(input);
+                }
+            }
+            if (line[0] != '\n' && line[0] != '\r') {
+                batch->too_long[num_lines] = too_long;
+                num_lines++;
+            }
+        }
+
+        // Analyze the batch in parallel
+        thread_pool_run(pool, analyze_batch_item, batch, num_lines);
+
+        // Write the results in input order with a single call
+        int length = 0;
+        for (int i = 0; i < num_lines; i++) {
+            length += format_analysis_result(
+                batch->lines[i], 
+                &(batch->results[i]), 
+                out + length
+            );
+        }
+        fwrite(out, 1, length, output);
+        batch->first_line += num_lines;
+    }
+    fflush(output);
+
+    // Free the allocated memory
+    free(out);
+    delete_thread_pool(pool);
+    for (int i = 0; i < num_threads; i++) {
+        delete_board(batch->boards[i]);
+        delete_engine(batch->engines[i]);
+    }
+    free(batch->boards);
+    free(batch->engines);
+    delete_adjacency_matrix(batch->adj_matrix);
+    free(batch);
+    return;
+}
+
+
+// **********
+// Review functions
+// The recorded games are read in batches. Each batch is replayed on the
+// main thread to find the position before every move, the positions are
+// searched in parallel (one task per move, so long and short games share
+// the threads) and the lines are written in game and move order
+
+// Score of each move of the turn player of a position, from its point of
+// view: an immediate win has the value of a win at the root, the other
+// moves have the fast search score
+// Returns the number of moves
+int get_review_scores(
+    const Rules* rules, 
+    EngineConfig* config, 
+    unsigned char* cells, 
+    int player, 
+    int plies_left, 
+    unsigned char* moves, 
+    int* scores
+) {
+    int num_moves = list_rules_moves(rules, cells, player, moves);
+    FastSearch search;
+    init_fast_search(&search, config, rules, plies_left);
+    fast_root_scores(&search, cells, player, scores);
+    for (int i = 0; i < num_moves; i++) {
+        apply_encoded_move(cells, moves[i], player);
+        if (rules_have_line(rules, cells, player)) {
+            scores[i] = SCORE_PER_HEIGHT * (config->max_height + 1);
+        }
+        undo_encoded_move(cells, moves[i], player);
+    }
+    return num_moves;
+}
+
+
+// Search the position before a move and compare the move with the best one
+// (thread pool task)
+void review_batch_item(void* context, int item, int worker) {
+    (void) worker;
+    ReviewBatch* batch = (ReviewBatch*) context;
+    ReviewItem* review = &(batch->items[item]);
+    if (!review->legal) {
+        return;
+    }
+    GameRecord* record = &(batch->records[review->game]);
+
+    unsigned char moves[MAX_MOVES];
+    int scores[MAX_MOVES];
+    int num_moves = get_review_scores(
+        &(variant_rules[record->variant]), 
+        &(batch->config), 
+        review->cells, 
+        review->player, 
+        MAX_RECORD_MOVES - review->ply, 
+        moves, 
+        scores
+    );
+    review->best_score = scores[0];
+    for (int i = 0; i < num_moves; i++) {
+        review->best_score = max(review->best_score, scores[i]);
+        if (moves[i] == record->moves[review->ply]) {
+            review->score = scores[i];
+        }
+    }
+    return;
+}
+
+
+// Replay the games of the batch and create one item per move
+// A game stops at its first illegal move (the item is marked)
+void prepare_review_batch(ReviewBatch* batch) {
+    batch->num_items = 0;
+    for (int game = 0; game < batch->num_games; game++) {
+        GameRecord* record = &(batch->records[game]);
+        if (record->variant < 0 || record->variant >= NUM_VARIANTS) {
+            // Unknown variant: a single illegal item for the first move
+            ReviewItem* review = &(batch->items[batch->num_items++]);
+            review->game = game;
+            review->ply = 0;
+            review->legal = false;
+            continue;
+        }
+        const Rules* rules = &(variant_rules[record->variant]);
+        unsigned char cells[NUM_NODES];
+        memcpy(cells, rules->start, NUM_NODES);
+
+        for (int ply = 0; ply < record->num_moves; ply++) {
+            ReviewItem* review = &(batch->items[batch->num_items++]);
+            review->game = game;
+            review->ply = ply;
+            review->player = (ply % 2 == 0) ? id_player_1 : id_player_2;
+            memcpy(review->cells, cells, NUM_NODES);
+
+            // The move must be one of the moves of the rules
+            unsigned char moves[MAX_MOVES];
+            int num_moves = list_rules_moves(
+                rules, 
+                cells, 
+                review->player, 
+                moves
+            );
+            review->legal = false;
+            for (int i = 0; i < num_moves; i++) {
+                review->legal = review->legal 
+                    || (moves[i] == record->moves[ply]);
+            }
+            if (!review->legal) {
+                break;
+            }
+            apply_encoded_move(cells, record->moves[ply], review->player);
+        }
+    }
+    return;
+}
+
+
+// Write the line of a reviewed move and add it to the summary
+// Format: game number, move number (both starting at 1), move (origin row
+// and column, destiny row and column), score of the move, best score,
+// score drop and mark (erro, vitoria_perdida or -)
+// Returns the number of characters written
+int format_review_item(
+    ReviewBatch* batch, 
+    ReviewItem* review, 
+    long long* counts
+) {
+    char* out = batch->out + batch->out_length;
+    int length = 0;
+    length += append_int(out + length, batch->first_game + review->game + 1);
+    out[length++] = ' ';
+    length += append_int(out + length, review->ply + 1);
+    if (!review->legal) {
+        memcpy(out + length, " invalida\n", 10);
+        counts[review_illegal]++;
+        return length + 10;
+    }
+
+    GameRecord* record = &(batch->records[review->game]);
+    Move move = decode_move(record->moves[review->ply]);
+    int values[7] = {
+        move.origin.row, move.origin.col, 
+        move.destiny.row, move.destiny.col, 
+        review->score, 
+        review->best_score, 
+        review->best_score - review->score
+    };
+    for (int i = 0; i < 7; i++) {
+        out[length++] = ' ';
+        length += append_int(out + length, values[i]);
+    }
+
+    // A missed win keeps no forced win from a won position and a blunder
+    // turns a position that is not lost into a forced loss
+    const char* mark = " -\n";
+    counts[review_moves]++;
+    if (review->best_score >= SCORE_PER_HEIGHT 
+        && review->score < SCORE_PER_HEIGHT) {
+        mark = " vitoria_perdida\n";
+        counts[review_missed_wins]++;
+    } else if (review->best_score > -SCORE_PER_HEIGHT 
+        && review->score <= -SCORE_PER_HEIGHT) {
+        mark = " erro\n";
+        counts[review_blunders]++;
+    }
+    int mark_length = strlen(mark);
+    memcpy(out + length, mark, mark_length);
+    return length + mark_length;
+}
+
+
+// Review all the games of a record file and write one line per move
+// Returns false if the file can not be read
+bool review_games(
+    const char* path, 
+    FILE* output, 
+    int num_threads, 
+    EngineConfig* config
+) {
+    GameRecordReader* reader = open_record_reader(path);
+    if (reader == NULL) {
+        printf("Nao foi possivel ler o arquivo de partidas %s.\n", path);
+        return false;
+    }
+    ReviewBatch* batch = (ReviewBatch*) malloc(sizeof(ReviewBatch));
+    batch->config = *config;
+    batch->first_game = 0;
+    ThreadPool* pool = create_thread_pool(num_threads);
+
+    long long counts[NUM_REVIEW_COUNTS] = {0, 0, 0, 0};
+    bool end_of_input = false;
+    while (!end_of_input) {
+        batch->num_games = 0;
+        while (batch->num_games < REVIEW_BATCH_GAMES && !end_of_input) {
+            GameRecord* record = &(batch->records[batch->num_games]);
+            if (read_game_record(reader, record)) {
+                batch->num_games++;
+            } else {
+                end_of_input = true;
+            }
+        }
+
+        prepare_review_batch(batch);
+        thread_pool_run(pool, review_batch_item, batch, batch->num_items);
+
+        // Write the lines in order with a single call
+        batch->out_length = 0;
+        for (int i = 0; i < batch->num_items; i++) {
+            batch->out_length += format_review_item(
+                batch, 
+                &(batch->items[i]), 
+                counts
+            );
+        }
+        fwrite(batch->out, 1, batch->out_length, output);
+        batch->first_game += batch->num_games;
+    }
+    fflush(output);
+    close_record_reader(reader);
+
+    printf(
+        "Partidas: %lld, jogadas: %lld, erros: %lld, "
+        "vitorias perdidas: %lld, jogadas invalidas: %lld\n", 
+        batch->first_game, 
+        counts[review_moves], 
+        counts[review_blunders], 
+        counts[review_missed_wins], 
+        counts[review_illegal]
+    );
+
+    delete_thread_pool(pool);
+    free(batch);
+    return true;
+}
+
+
+// **********
+// Game graph functions
+// The graph has one node per position reachable from the start of a
+// variant (numbered in breadth-first order from the start) and one edge per
+// move. It is written in compressed sparse row form: the edges of node i
+// are the edges offsets[i] to offsets[i + 1] - 1.
+
+// Build the graph of the positions reachable from the start of a variant
+// Only variants without the drop phase and with NUM_PIECES pieces (the
+// positions of rank_position) are supported
+// Returns false if the variant is not supported
+bool build_game_graph(const Rules* rules, GameGraph* graph) {
+    if (rules->drop_phase || rules->num_pieces != NUM_PIECES) {
+        return false;
+    }
+    for (int rank = 0; rank < NUM_POSITION_INDICES; rank++) {
+        graph->node_of_rank[rank] = -1;
+    }
+    unsigned char cells[NUM_NODES];
+    memcpy(cells, rules->start, NUM_NODES);
+    int start = rank_position(cells, id_player_1);
+    graph->node_of_rank[start] = 0;
+    graph->ranks[0] = (uint16_t) start;
+    graph->num_nodes = 1;
+    graph->num_edges = 0;
+
+    // The queue of the search is the list of nodes itself
+    for (int node = 0; node < graph->num_nodes; node++) {
+        int turn_player;
+        unrank_position(graph->ranks[node], cells, &turn_player);
+        int last_player = (turn_player == id_player_1) 
+            ? id_player_2 : id_player_1;
+        graph->offsets[node] = (uint32_t) graph->num_edges;
+
+        // The game is over after a win
+        unsigned char attributes = (unsigned char) turn_player;
+        if (rules_have_line(rules, cells, last_player)) {
+            graph->attributes[node] = attributes 
+                | GRAPH_TERMINAL | (last_player << GRAPH_WINNER_SHIFT);
+            continue;
+        }
+
+        unsigned char moves[MAX_MOVES];
+        int num_moves = list_rules_moves(rules, cells, turn_player, moves);
+        // A player without valid moves ends the game as a draw
+        if (num_moves == 0) {
+            attributes |= GRAPH_TERMINAL;
+        }
+        graph->attributes[node] = attributes 
+            | (id_empty << GRAPH_WINNER_SHIFT);
+
+        for (int i = 0; i < num_moves; i++) {
+            apply_encoded_move(cells, moves[i], turn_player);
+            int rank = rank_position(cells, last_player);
+            undo_encoded_move(cells, moves[i], turn_player);
+
+            if (graph->node_of_rank[rank] == -1) {
+                graph->node_of_rank[rank] = graph->num_nodes;
+                graph->ranks[graph->num_nodes] = (uint16_t) rank;
+                graph->num_nodes++;
+            }
+            graph->targets[graph->num_edges] = (
+                (uint32_t) graph->node_of_rank[rank]
+            );
+            graph->moves[graph->num_edges] = moves[i];
+            graph->num_edges++;
+        }
+    }
+    graph->offsets[graph->num_nodes] = (uint32_t) graph->num_edges;
+    return true;
+}
+
+
+// Write the graph as a flat binary file: header, offsets, targets (4 bytes
+// each), ranks (2 bytes each), moves and attributes (1 byte each), so every
+// array keeps its alignment when the file is memory-mapped
+// Returns false if the file can not be written
+bool write_game_graph(const char* path, GameGraph* graph, int variant) {
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        return false;
+    }
+
+    unsigned char header[GRAPH_HEADER_SIZE];
+    memset(header, 0, GRAPH_HEADER_SIZE);
+    memcpy(header, GRAPH_MAGIC, GRAPH_MAGIC_SIZE);
+    header[GRAPH_MAGIC_SIZE] = GRAPH_VERSION;
+    header[GRAPH_MAGIC_SIZE + 1] = (unsigned char) variant;
+    store_little_endian(header + 8, graph->num_nodes, 4);
+    store_little_endian(header + 12, graph->num_edges, 4);
+
+    // Arrays in little-endian order
+    size_t num_nodes = graph->num_nodes;
+    size_t num_edges = graph->num_edges;
+    size_t size = GRAPH_HEADER_SIZE + 4 * (num_nodes + 1) + 4 * num_edges 
+        + 2 * num_nodes + num_edges + num_nodes;
+    unsigned char* out = (unsigned char*) malloc(size);
+    unsigned char* cursor = out;
+    memcpy(cursor, header, GRAPH_HEADER_SIZE);
+    cursor += GRAPH_HEADER_SIZE;
+    for (size_t i = 0; i <= num_nodes; i++, cursor += 4) {
+        store_little_endian(cursor, graph->offsets[i], 4);
+    }
+    for (size_t i = 0; i < num_edges; i++, cursor += 4) {
+        store_little_endian(cursor, graph->targets[i], 4);
+    }
+    for (size_t i = 0; i < num_nodes; i++, cursor += 2) {
+        store_little_endian(cursor, graph->ranks[i], 2);
+    }
+    memcpy(cursor, graph->moves, num_edges);
+    cursor += num_edges;
+    memcpy(cursor, graph->attributes, num_nodes);
+
+    bool written = fwrite(out, 1, size, file) == size;
+    written = (fclose(file) == 0) && written;
+    free(out);
+    return written;
+}
+
+
+// Build the graph of a variant and write it to a file
+// Returns false if the variant is not supported or the file can not be
+// written
+bool export_game_graph(const char* path, int variant) {
+    GameGraph* graph = (GameGraph*) malloc(sizeof(GameGraph));
+    bool exported = false;
+    if (!build_game_graph(&(variant_rules[variant]), graph)) {
+        printf(
+            "A variante %s nao tem um grafo de posicoes.\n", 
+            variant_rules[variant].name
+        );
+    } else if (!write_game_graph(path, graph, variant)) {
+        printf("Nao foi possivel escrever o arquivo %s.\n", path);
+    } else {
+        int counts[3] = {0, 0, 0};
+        int num_terminals = 0;
+        for (int node = 0; node < graph->num_nodes; node++) {
+            unsigned char attributes = graph->attributes[node];
+            if (attributes & GRAPH_TERMINAL) {
+                num_terminals++;
+                counts[attributes >> GRAPH_WINNER_SHIFT]++;
+            }
+        }
+        printf(
+            "Grafo %s: %d posicoes, %d jogadas, %d finais "
+            "(vitorias de %c %d, vitorias de %c %d, sem jogadas %d)\n", 
+            path, 
+            graph->num_nodes, 
+            graph->num_edges, 
+            num_terminals, 
+            PLAYER_1, counts[id_player_1], 
+            PLAYER_2, counts[id_player_2], 
+            counts[id_empty]
+        );
+        exported = true;
+    }
+    free(graph);
+    return exported;
+}
+
+
+// **********
+// Solver functions
+// The solver decides every position of a variant after the pieces are on
+// the board (all the pieces of both players, any side to move) by
+// retrograde analysis. Each position has a bit on the array of the
+// positions won by the turn player and a bit on the array of the positions
+// lost by it. A pass checks every undecided position against its successors
+// and the passes stop when one decides nothing: the positions left are
+// draws. Both arrays live in a memory-mapped file, so the passes are kept
+// when the solver is interrupted and the state space is not bound by the
+// memory.
+
+// Read the bit of a position
+// Other threads may be setting bits of the same word
+bool get_solver_bit(const uint64_t* bits, int64_t rank) {
+    uint64_t word = __atomic_load_n(&(bits[rank >> 6]), __ATOMIC_RELAXED);
+    return (word >> (rank & 63)) & 1;
+}
+
+
+// Set the bit of a position
+void set_solver_bit(uint64_t* bits, int64_t rank) {
+    __atomic_fetch_or(
+        &(bits[rank >> 6]), 
+        (uint64_t) 1 << (rank & 63), 
+        __ATOMIC_RELAXED
+    );
+    return;
+}
+
+
+// Open the file of the solver of the variant, creating it if it is missing
+// or empty
+// Any other file is left untouched
+// Returns false if the file is not a solver file of the variant or can not
+// be created or mapped
+bool open_solver_file(Solver* solver, const char* path) {
+    solver->num_words = (solver->index.num_positions + 63) / 64;
+    solver->size = SOLVER_HEADER_SIZE 
+        + 2 * sizeof(uint64_t) * (size_t) solver->num_words;
+
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    struct stat file_stat;
+    if (fd == -1 || fstat(fd, &file_stat) != 0) {
+        printf("Nao foi possivel criar o arquivo %s.\n", path);
+        if (fd != -1) {
+            close(fd);
+        }
+        return false;
+    }
+    bool resumed = file_stat.st_size != 0;
+    unsigned char header[SOLVER_HEADER_SIZE];
+    if (resumed && ((size_t) file_stat.st_size != solver->size
+        || lseek(fd, 0, SEEK_SET) != 0
+        || read(fd, header, SOLVER_HEADER_SIZE) != SOLVER_HEADER_SIZE
+        || memcmp(header, SOLVER_MAGIC, SOLVER_MAGIC_SIZE) != 0
+        || header[SOLVER_MAGIC_SIZE] != SOLVER_VERSION
+        || header[SOLVER_MAGIC_SIZE + 1] != solver->variant
+        || load_little_endian(header + 16, 8) 
+            != (uint64_t) solver->index.num_positions)) {
+        printf(
+            "O arquivo %s nao e do solucionador da variante %s.\n", 
+            path, 
+            solver->rules->name
+        );
+        close(fd);
+        return false;
+    }
+
+    // Start from empty arrays (ftruncate fills them with zeros)
+    if (!resumed && ftruncate(fd, solver->size) != 0) {
+        printf("Nao foi possivel criar o arquivo %s.\n", path);
+        close(fd);
+        return false;
+    }
+    solver->data = (unsigned char*) mmap(
+        NULL, 
+        solver->size, 
+        PROT_READ | PROT_WRITE, 
+        MAP_SHARED, 
+        fd, 
+        0
+    );
+    // The mapping keeps the file open
+    close(fd);
+    if (solver->data == MAP_FAILED) {
+        solver->data = NULL;
+        printf("Nao foi possivel criar o arquivo %s.\n", path);
+        return false;
+    }
+    solver->wins = (uint64_t*) (solver->data + SOLVER_HEADER_SIZE);
+    solver->losses = solver->wins + solver->num_words;
+
+    if (!resumed) {
+        memcpy(solver->data, SOLVER_MAGIC, SOLVER_MAGIC_SIZE);
+        solver->data[SOLVER_MAGIC_SIZE] = SOLVER_VERSION;
+        solver->data[SOLVER_MAGIC_SIZE + 1] = (unsigned char) solver->variant;
+        solver->data[SOLVER_MAGIC_SIZE + 2] = (unsigned char) (
+            solver->index.num_pieces
+        );
+        store_little_endian(
+            solver->data + 16, 
+            (uint64_t) solver->index.num_positions, 
+            8
+        );
+    }
+    return true;
+}
+
+
+// Check the undecided positions of one set of nodes of player 1 (a task of
+// the thread pool)
+// A position is lost when the last player has a line or when every move
+// leads to a position won by the opponent, and won when a move leads to a
+// position lost by the opponent. The bits only go from 0 to 1, so reading
+// bits set by other threads in the same pass is safe.
+void solve_piece_set(void* context, int item, int worker) {
+    (void) worker;
+    Solver* solver = (Solver*) context;
+    const PositionIndex* index = &(solver->index);
+    long long num_changes = 0;
+
+    int64_t first = (int64_t) item * index->num_free_sets * 2;
+    int64_t last = first + (int64_t) index->num_free_sets * 2;
+    for (int64_t rank = first; rank < last; rank++) {
+        if (get_solver_bit(solver->wins, rank) 
+            || get_solver_bit(solver->losses, rank)) {
+            continue;
+        }
+        unsigned char cells[NUM_NODES];
+        int turn_player;
+        unrank_indexed_position(index, (int) rank, cells, &turn_player);
+        int last_player = (turn_player == id_player_1) 
+            ? id_player_2 : id_player_1;
+        if (rules_have_line(solver->rules, cells, last_player)) {
+            set_solver_bit(solver->losses, rank);
+            num_changes++;
+            continue;
+        }
+
+        unsigned char moves[MAX_MOVES];
+        int num_moves = list_rules_moves(
+            solver->rules, 
+            cells, 
+            turn_player, 
+            moves
+        );
+        // A player without valid moves ends the game as a draw
+        bool lost = num_moves > 0;
+        bool won = false;
+        for (int i = 0; i < num_moves && !won; i++) {
+            apply_encoded_move(cells, moves[i], turn_player);
+            int64_t next = rank_indexed_position(index, cells, last_player);
+            undo_encoded_move(cells, moves[i], turn_player);
+            won = get_solver_bit(solver->losses, next);
+            lost = lost && get_solver_bit(solver->wins, next);
+        }
+        if (won) {
+            set_solver_bit(solver->wins, rank);
+            num_changes++;
+        } else if (lost) {
+            set_solver_bit(solver->losses, rank);
+            num_changes++;
+        }
+    }
+    __atomic_fetch_add(&(solver->num_changes), num_changes, __ATOMIC_RELAXED);
+    return;
+}
+
+
+// Value of a position for the turn player (1 won, -1 lost, 0 draw) from the
+// arrays of the solver
+int get_solver_value(Solver* solver, unsigned char* cells, int turn_player) {
+    int64_t rank = rank_indexed_position(
+        &(solver->index), 
+        cells, 
+        turn_player
+    );
+    if (get_solver_bit(solver->wins, rank)) {
+        return 1;
+    }
+    return get_solver_bit(solver->losses, rank) ? -1 : 0;
+}
+
+
+// Value of a position of the drop phase for the turn player, searching the
+// drops up to the positions of the solver
+int get_solver_drop_value(
+    Solver* solver, 
+    unsigned char* cells, 
+    int turn_player
+) {
+    unsigned char moves[MAX_MOVES];
+    int num_moves = list_rules_moves(solver->rules, cells, turn_player, moves);
+    // The turn player has all its pieces, so both players have
+    if (num_moves > 0 && moves[0] / NUM_NODES != moves[0] % NUM_NODES) {
+        return get_solver_value(solver, cells, turn_player);
+    }
+
+    int other_player = (turn_player == id_player_1) 
+        ? id_player_2 : id_player_1;
+    int best_value = (num_moves > 0) ? -1 : 0;
+    for (int i = 0; i < num_moves && best_value < 1; i++) {
+        apply_encoded_move(cells, moves[i], turn_player);
+        int value = rules_have_line(solver->rules, cells, turn_player) ? 1 
+            : -get_solver_drop_value(solver, cells, other_player);
+        undo_encoded_move(cells, moves[i], turn_player);
+        best_value = max(best_value, value);
+    }
+    return best_value;
+}
+
+
+// Solve a variant, keeping the arrays in a file
+// A file of the same variant is resumed from its last pass; other files
+// that are not empty are refused
+// The turn limit (MAX_TURNS) is not part of the positions: the values are
+// those of a game without the limit
+// Returns false if the file can not be created or written
+bool solve_variant(const char* path, int variant, int num_threads) {
+    Solver solver;
+    solver.rules = &(variant_rules[variant]);
+    solver.variant = variant;
+    init_position_index(&(solver.index), solver.rules->num_pieces);
+    if (!open_solver_file(&solver, path)) {
+        return false;
+    }
+
+    const PositionIndex* index = &(solver.index);
+    int num_passes = (int) load_little_endian(solver.data + 8, 4);
+    bool done = solver.data[SOLVER_MAGIC_SIZE + 3] == SOLVER_DONE;
+    printf(
+        "Variante %s: %lld posicoes (%d pecas por jogador)\n", 
+        solver.rules->name, 
+        (long long) index->num_positions, 
+        index->num_pieces
+    );
+    if (num_passes > 0 && !done) {
+        printf("Continuando do passo %d\n", num_passes + 1);
+    }
+
+    bool written = true;
+    ThreadPool* pool = create_thread_pool(num_threads);
+    uint64_t start_time = get_time_microseconds();
+    while (!done && written) {
+        uint64_t pass_start = get_time_microseconds();
+        solver.num_changes = 0;
+        thread_pool_run(pool, solve_piece_set, &solver, index->num_sets);
+        // At least one microsecond for the throughput
+        uint64_t elapsed = get_time_microseconds() - pass_start + 1;
+        num_passes++;
+        printf(
+            "Passo %d: %lld posicoes decididas em %.3f s "
+            "(%.0f posicoes/s)\n", 
+            num_passes, 
+            solver.num_changes, 
+            elapsed / 1e6, 
+            index->num_positions * 1e6 / elapsed
+        );
+        fflush(stdout);
+
+        // Write the arrays before the pass that covers them
+        written = msync(solver.data, solver.size, MS_SYNC) == 0;
+        store_little_endian(solver.data + 8, num_passes, 4);
+        done = solver.num_changes == 0;
+        if (done) {
+            solver.data[SOLVER_MAGIC_SIZE + 3] = SOLVER_DONE;
+        }
+        written = written && msync(solver.data, solver.size, MS_SYNC) == 0;
+    }
+    uint64_t elapsed = get_time_microseconds() - start_time;
+    delete_thread_pool(pool);
+
+    if (!written) {
+        printf("Nao foi possivel escrever o arquivo %s.\n", path);
+    } else {
+        long long num_wins = 0;
+        long long num_losses = 0;
+        for (int64_t word = 0; word < solver.num_words; word++) {
+            num_wins += __builtin_popcountll(solver.wins[word]);
+            num_losses += __builtin_popcountll(solver.losses[word]);
+        }
+        printf(
+            "Resolvido em %d passos (%.3f s nesta execucao): "
+            "%lld vitorias, %lld derrotas e %lld empates do jogador da vez\n", 
+            num_passes, 
+            elapsed / 1e6, 
+            num_wins, 
+            num_losses, 
+            (long long) index->num_positions - num_wins - num_losses
+        );
+
+        unsigned char cells[NUM_NODES];
+        memcpy(cells, solver.rules->start, NUM_NODES);
+        int value = solver.rules->drop_phase 
+            ? get_solver_drop_value(&solver, cells, id_player_1) 
+            : get_solver_value(&solver, cells, id_player_1);
+        if (value == 0) {
+            printf("Posicao inicial: empate\n");
+        } else {
+            printf(
+                "Posicao inicial: vitoria de %c\n", 
+                (value > 0) ? PLAYER_1 : PLAYER_2
+            );
+        }
+    }
+    munmap(solver.data, solver.size);
+    return written;
+}
+
+
+// **********
+// Script replay functions
+
+// Load the whole script in memory
+// The file is memory-mapped; "-" reads the standard input
+// Returns NULL if the script can not be read
+char* load_script(const char* path, size_t* size, bool* mapped) {
+    *size = 0;
+    *mapped = false;
+
+    if (strcmp(path, "-") == 0) {
+        // Read the standard input in blocks
+        size_t capacity = REPLAY_OUTPUT_SIZE;
+        char* data = (char*) malloc(capacity);
+        size_t read_size = fread(data, 1, capacity, stdin);
+        while (read_size > 0) {
+            *size += read_size;
+            if (*size == capacity) {
+                capacity *= 2;
+                data = (char*) realloc(data, capacity);
+            }
+            read_size = fread(data + *size, 1, capacity - *size, stdin);
+        }
+        return data;
+    }
+
+    int file = open(path, O_RDONLY);
+    if (file < 0) {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+        close(file);
+        return NULL;
+    }
+    *size = (size_t) info.st_size;
+
+    // An empty file can not be mapped, but it is a valid (empty) script
+    if (*size == 0) {
+        close(file);
+        return (char*) malloc(1);
+    }
+    char* data = (char*) mmap(NULL, *size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+    *mapped = true;
+    return data;
+}
+
+
+// Read the next integer of a line
+// Returns 1 if an integer was read, 0 at the end of the line and -1 if
+// there is something else on the line
+int scan_int(const char** cursor, const char* end, int* value) {
+    const char* c = *cursor;
+
+    // Skip the spaces between the integers
+    while (c < end && (*c == ' ' || *c == '\t' || *c == '\r')) {
+        c++;
+    }
+    if (c == end) {
+        *cursor = c;
+        return 0;
+    }
+
+    bool negative = false;
+    if (*c == '-') {
+        negative = true;
+        c++;
+    }
+    if (c == end || *c < '0' || *c > '9') {
+        return -1;
+    }
+
+    int result = 0;
+    while (c < end && *c >= '0' && *c <= '9') {
+        // Large numbers are invalid positions anyway, just avoid overflows
+        if (result < 100000) {
+            result = result * 10 + (*c - '0');
+        }
+        c++;
+    }
+
+    *value = negative ? -result : result;
+    *cursor = c;
+    return 1;
+}
+
+
+// Replay the moves of a script line from the initial position
+void replay_game_line(
+    const char* line,
+    const char* end,
+    Board* board,
+    AdjacencyMatrix* adj_matrix,
+    ReplayResult* result
+) {
+    set_initial_position(board);
+    board->turn_player = id_player_1;
+    result->status = replay_in_progress;
+    result->num_moves = 0;
+    result->bad_move = 0;
+
+    const char* cursor = line;
+    int values[4];
+    while (true) {
+        // Read the four integers of a move
+        int num_values = 0;
+        int scanned = 1;
+        while (num_values < 4 && scanned == 1) {
+            scanned = scan_int(&cursor, end, &(values[num_values]));
+            if (scanned == 1) {
+                num_values++;
+            }
+        }
+        if (scanned == -1 || (scanned == 0 && num_values > 0)) {
+            // Not an integer or an incomplete move
+            result->status = replay_malformed;
+            return;
+        }
+        if (num_values == 0) {
+            // End of the line
+            return;
+        }
+
+        Move move;
+        move.origin.row = values[0];
+        move.origin.col = values[1];
+        move.destiny.row = values[2];
+        move.destiny.col = values[3];
+
+        // No moves are allowed after the end of the game
+        bool game_over = (
+            result->status != replay_in_progress 
+            || result->num_moves >= MAX_TURNS * 2
+        );
+        if (game_over || !is_valid_move(board, move, adj_matrix)) {
+            result->status = replay_illegal_move;
+            result->bad_move = result->num_moves + 1;
+            return;
+        }
+
+        // Make the move
+        set_player(move.destiny, board->turn_player, board);
+        set_player(move.origin, id_empty, board);
+        result->num_moves++;
+
+        // Check the end of the game and change the turn player
+        if (player_is_winner(board)) {
+            board->winner = board->turn_player;
+            result->status = replay_win;
+        } else if (result->num_moves == MAX_TURNS * 2) {
+            result->status = replay_draw;
+        }
+        board->turn_player = (
+            (board->turn_player == id_player_1) ? id_player_2 : id_player_1
+        );
+    }
+}
+
+
+// Write the result of a replayed game
+// Format: game number, position reached, number of moves and the result
+// Returns the number of characters written
+int format_replay_result(
+    int game_number, 
+    Board* board, 
+    ReplayResult* result, 
+    char* out
+) {
+    int length = append_int(out, game_number);
+    out[length++] = ' ';
+    length += format_position_notation(board, out + length);
+    out[length++] = ' ';
+    length += append_int(out + length, result->num_moves);
+    out[length++] = ' ';
+
+    if (result->status == replay_win) {
+        out[length++] = get_symbol_from_player(board->winner);
+    } else if (result->status == replay_draw) {
+        memcpy(out + length, "empate", 6);
+        length += 6;
+    } else if (result->status == replay_in_progress) {
+        memcpy(out + length, "andamento", 9);
+        length += 9;
+    } else if (result->status == replay_illegal_move) {
+        memcpy(out + length, "invalida ", 9);
+        length += 9;
+        length += append_int(out + length, result->bad_move);
+    } else {
+        memcpy(out + length, "malformada", 10);
+        length += 10;
+    }
+    out[length++] = '\n';
+    return length;
+}
+
+
+// Replay all games of a script (one game per line)
+// Returns the number of games with an illegal move or malformed input
+int replay_script(const char* path) {
+    size_t size;
+    bool mapped;
+    char* data = load_script(path, &size, &mapped);
+    if (data == NULL) {
+        printf("Nao foi possivel ler o arquivo %s.\n", path);
+        return -1;
+    }
+
+    Board* board = create_board();
+    AdjacencyMatrix* adj_matrix = create_adjacency_matrix(NUM_NODES);
+    char* out = (char*) malloc(REPLAY_OUTPUT_SIZE);
+    int length = 0;
+
+    int num_games = 0;
+    int num_errors = 0;
+    const char* line = data;
+    const char* data_end = data + size;
+    while (line < data_end) {
+        // Find the end of the line
+        const char* end = memchr(line, '\n', data_end - line);
+        if (end == NULL) {
+            end = data_end;
+        }
+
+        // Empty lines and comments (starting with #) are ignored
+        const char* first = line;
+        while (first < end && (*first == ' ' || *first == '\t' 
+            || *first == '\r')) {
+            first++;
+        }
+        if (first < end && *first != '#') {
+            ReplayResult result;
+            replay_game_line(first, end, board, adj_matrix, &result);
+            num_games++;
+            if (result.status == replay_illegal_move 
+                || result.status == replay_malformed) {
+                num_errors++;
+            }
+
+            // Write the output when the buffer is almost full
+            if (length + ANALYSIS_LINE_SIZE > REPLAY_OUTPUT_SIZE) {
+                fwrite(out, 1, length, stdout);
+                length = 0;
+            }
+            length += format_replay_result(
+                num_games, 
+                board, 
+                &result, 
+                out + length
+            );
+        }
+        line = end + 1;
+    }
+    fwrite(out, 1, length, stdout);
+    fflush(stdout);
+
+    // Free the allocated memory
+    free(out);
+    delete_board(board);
+    delete_adjacency_matrix(adj_matrix);
+    if (mapped) {
+        munmap(data, size);
+    } else {
+        free(data);
+    }
+    return num_errors;
+}
+
+
+// **********
+// Tournament functions
+
+// Read an engine configuration such as "depth=6,eval=0,type=pns"
+// The keys not given keep the values of the base configuration
+bool parse_engine_config(const char* text, EngineConfig* config) {
+    const char* cursor = text;
+    while (*cursor != '\0') {
+        // Split the key and the value
+        const char* equal = strchr(cursor, '=');
+        if (equal == NULL) {
+            return false;
+        }
+        const char* value = equal + 1;
+        const char* end = strchr(value, ',');
+        if (end == NULL) {
+            end = value + strlen(value);
+        }
+        int key_length = (int) (equal - cursor);
+        int value_length = (int) (end - value);
+        if (value_length == 0) {
+            return false;
+        }
+
+        if (key_length == 4 && strncmp(cursor, "type", 4) == 0) {
+            if (value_length == 7 && strncmp(value, "minimax", 7) == 0) {
+                config->type = engine_minimax;
+            } else if (value_length == 3 && strncmp(value, "pns", 3) == 0) {
+                config->type = engine_proof_number;
+            } else if (value_length == 4 && strncmp(value, "fast", 4) == 0) {
+                config->type = engine_fast;
+            } else {
+                return false;
+            }
+        } else {
+            char* number_end;
+            long number = strtol(value, &number_end, 10);
+            if (number_end != end || number < 0) {
+                return false;
+            }
+            if (key_length == 5 && strncmp(cursor, "depth", 5) == 0) {
+                config->max_height = (int) number;
+            } else if (key_length == 4 && strncmp(cursor, "eval", 4) == 0) {
+                config->use_evaluation = (number != 0);
+            } else if (key_length == 5 && strncmp(cursor, "nodes", 5) == 0) {
+                config->max_nodes = (int) number;
+            } else if (key_length == 5 && strncmp(cursor, "reuse", 5) == 0) {
+                config->reuse_tree = (number != 0);
+            } else {
+                return false;
+            }
+        }
+        cursor = (*end == ',') ? end + 1 : end;
+    }
+    return true;
+}
+
+
+// Play one game of the tournament
+void play_tournament_game(void* context, int item, int worker) {
+    Tournament* tournament = (Tournament*) context;
+    TournamentGame* game = &(tournament->games[item]);
+    int first_engine = worker * tournament->num_configs;
+
+    // Each side has its own engines, since the engines keep the search tree
+    Engine* engines[2];
+    engines[id_player_1] = tournament->engines[
+        first_engine + game->configs[id_player_1]
+    ];
+    engines[id_player_2] = tournament->second_engines[
+        first_engine + game->configs[id_player_2]
+    ];
+    uint64_t seed = tournament->seed + item;
+    seed_engine(engines[id_player_1], seed);
+    seed_engine(engines[id_player_2], ~seed);
+
+    // Measure the work of each side
+    uint64_t cpu_time[2];
+    long long num_moves[2];
+    for (int side = 0; side < 2; side++) {
+        cpu_time[side] = engines[side]->cpu_time;
+        num_moves[side] = engines[side]->num_moves;
+    }
+
+    GameRecord record;
+    init_game_record(&record, VARIANT_CLASSIC, seed);
+    game->winner = play_computer_game(engines, &record, NULL);
+
+    for (int side = 0; side < 2; side++) {
+        game->cpu_time[side] = engines[side]->cpu_time - cpu_time[side];
+        game->num_moves[side] = engines[side]->num_moves - num_moves[side];
+    }
+    return;
+}
+
+
+// Convert an expected score (between 0 and 1) to an Elo difference
+double get_elo_difference(double score) {
+    // Perfect scores have no finite difference
+    score = fmin(fmax(score, 0.001), 0.999);
+    return -400.0 * log10(1.0 / score - 1.0);
+}
+
+
+// Estimate the Elo difference of a player against its opponents and the
+// margin of its 95% confidence interval
+void get_elo_estimate(
+    int wins, 
+    int draws, 
+    int losses, 
+    double* elo, 
+    double* margin
+) {
+    double num_games = wins + draws + losses;
+    if (num_games == 0) {
+        *elo = 0;
+        *margin = 0;
+        return;
+    }
+    double score = (wins + 0.5 * draws) / num_games;
+
+    // Standard error of the mean score of a game
+    double variance = (
+        wins * (1.0 - score) * (1.0 - score) 
+        + draws * (0.5 - score) * (0.5 - score) 
+        + losses * score * score
+    ) / num_games;
+    double error = sqrt(variance / num_games);
+
+    *elo = get_elo_difference(score);
+    *margin = (
+        get_elo_difference(score + 1.96 * error) 
+        - get_elo_difference(score - 1.96 * error)
+    ) / 2.0;
+    return;
+}
+
+
+// Play every pair of configurations with both colours and print the results
+// The configurations are separated by spaces, e.g. "depth=10 depth=6,eval=0"
+// Returns false if a configuration is invalid
+bool run_tournament(
+    const char* configs_text, 
+    int games_per_colour, 
+    int num_threads, 
+    uint64_t seed, 
+    EngineConfig* base_config
+) {
+    Tournament* tournament = (Tournament*) malloc(sizeof(Tournament));
+    tournament->num_configs = 0;
+    tournament->seed = seed;
+
+    // Read the configurations
+    const char* cursor = configs_text;
+    while (*cursor != '\0') {
+        while (*cursor == ' ') {
+            cursor++;
+        }
+        int length = (int) strcspn(cursor, " ");
+        if (length == 0) {
+            break;
+        }
+        int index = tournament->num_configs;
+        if (index == MAX_TOURNAMENT_CONFIGS || length >= TOURNAMENT_NAME_SIZE) {
+            printf("Configuracoes demais ou muito longas.\n");
+            free(tournament);
+            return false;
+        }
+        memcpy(tournament->names[index], cursor, length);
+        tournament->names[index][length] = '\0';
+        tournament->configs[index] = *base_config;
+        if (!parse_engine_config(
+            tournament->names[index], 
+            &(tournament->configs[index])
+        )) {
+            printf("Configuracao invalida: %s\n", tournament->names[index]);
+            free(tournament);
+            return false;
+        }
+        tournament->num_configs++;
+        cursor += length;
+    }
+    int num_configs = tournament->num_configs;
+    if (num_configs < 2) {
+        printf("O torneio precisa de pelo menos duas configuracoes.\n");
+        free(tournament);
+        return false;
+    }
+
+    // Every pair plays the same number of games with each colour
+    int num_pairs = num_configs * (num_configs - 1) / 2;
+    tournament->num_games = num_pairs * 2 * games_per_colour;
+    tournament->games = (TournamentGame*) malloc(
+        sizeof(TournamentGame) * tournament->num_games
+    );
+    int game = 0;
+    for (int a = 0; a < num_configs; a++) {
+        for (int b = a + 1; b < num_configs; b++) {
+            for (int i = 0; i < 2 * games_per_colour; i++) {
+                bool swap = (i % 2 == 1);
+                tournament->games[game].configs[id_player_1] = swap ? b : a;
+                tournament->games[game].configs[id_player_2] = swap ? a : b;
+                game++;
+            }
+        }
+    }
+
+    // One engine per configuration and side for each worker
+    int num_engines = num_threads * num_configs;
+    tournament->engines = (Engine**) malloc(sizeof(Engine*) * num_engines);
+    tournament->second_engines = (Engine**) malloc(
+        sizeof(Engine*) * num_engines
+    );
+    for (int i = 0; i < num_engines; i++) {
+        EngineConfig* config = &(tournament->configs[i % num_configs]);
+        tournament->engines[i] = create_engine(seed, config);
+        tournament->second_engines[i] = create_engine(seed, config);
+    }
+
+    ThreadPool* pool = create_thread_pool(num_threads);
+    thread_pool_run(
+        pool, 
+        play_tournament_game, 
+        tournament, 
+        tournament->num_games
+    );
+    delete_thread_pool(pool);
+
+    // Sum the results of each configuration
+    int wins[MAX_TOURNAMENT_CONFIGS] = {0};
+    int draws[MAX_TOURNAMENT_CONFIGS] = {0};
+    int losses[MAX_TOURNAMENT_CONFIGS] = {0};
+    double cpu_time[MAX_TOURNAMENT_CONFIGS] = {0};
+    long long num_moves[MAX_TOURNAMENT_CONFIGS] = {0};
+    for (int i = 0; i < tournament->num_games; i++) {
+        TournamentGame* played = &(tournament->games[i]);
+        for (int side = 0; side < 2; side++) {
+            int config = played->configs[side];
+            if (played->winner == id_empty) {
+                draws[config]++;
+            } else if (played->winner == side) {
+                wins[config]++;
+            } else {
+                losses[config]++;
+            }
+            cpu_time[config] += played->cpu_time[side];
+            num_moves[config] += played->num_moves[side];
+        }
+    }
+
+    printf(
+        "%d configuracoes, %d partidas (%d com cada cor por par)\n", 
+        num_configs, 
+        tournament->num_games, 
+        games_per_colour
+    );
+    printf(
+        "%-32s %5s %5s %5s %7s %13s %12s\n", 
+        "configuracao", "V", "E", "D", "pontos", "Elo", "CPU/jogada"
+    );
+    for (int i = 0; i < num_configs; i++) {
+        double elo;
+        double margin;
+        get_elo_estimate(wins[i], draws[i], losses[i], &elo, &margin);
+        int num_games = wins[i] + draws[i] + losses[i];
+        printf(
+            "%-32s %5d %5d %5d %6.1f%% %+6.0f +-%4.0f %9.3f ms\n",
+            tournament->names[i],
+            wins[i],
+            draws[i],
+            losses[i],
+            100.0 * (wins[i] + 0.5 * draws[i]) / num_games,
+            elo,
+            margin,
+            (num_moves[i] > 0) ? cpu_time[i] / num_moves[i] / 1e6 : 0.0
+        );
+    }
+
+    // Free the allocated memory
+    for (int i = 0; i < num_engines; i++) {
+        delete_engine(tournament->engines[i]);
+        delete_engine(tournament->second_engines[i]);
+    }
+    free(tournament->engines);
+    free(tournament->second_engines);
+    free(tournament->games);
+    free(tournament);
+    return true;
+}
+
+
+// **********
+// Scheduler functions
+
+// Start a scheduler on the full budget
+// The target latency is in microseconds
+void init_engine_scheduler(
+    EngineScheduler* scheduler, 
+    EngineConfig* config, 
+    uint64_t target_latency, 
+    int num_threads
+) {
+    memset(scheduler, 0, sizeof(EngineScheduler));
+    scheduler->base_config = *config;
+    scheduler->target_latency = target_latency;
+    scheduler->max_queued = num_threads * SCHEDULER_QUEUE_PER_THREAD;
+    pthread_mutex_init(&(scheduler->mutex), NULL);
+    return;
+}
+
+
+void destroy_engine_scheduler(EngineScheduler* scheduler) {
+    pthread_mutex_destroy(&(scheduler->mutex));
+    return;
+}
+
+
+// Count moves requested at once (each one is finished by
+// finish_scheduled_move)
+// A queue over the limit raises the level right away, one level more each
+// time it doubles, so the moves of a burst already start degraded
+void request_scheduled_moves(EngineScheduler* scheduler, int num_moves) {
+    pthread_mutex_lock(&(scheduler->mutex));
+    scheduler->queued += num_moves;
+    int new_level = 0;
+    for (
+        int limit = scheduler->max_queued; 
+        scheduler->queued > limit && new_level < SCHEDULER_LEVELS - 1; 
+        limit *= 2
+    ) {
+        new_level++;
+    }
+    if (new_level > scheduler->level) {
+        __atomic_store_n(&(scheduler->level), new_level, __ATOMIC_RELAXED);
+        scheduler->moves_since_change = 0;
+    }
+    pthread_mutex_unlock(&(scheduler->mutex));
+    return;
+}
+
+
+// Get the active degradation level (0 is the full budget)
+int get_degradation_level(EngineScheduler* scheduler) {
+    return __atomic_load_n(&(scheduler->level), __ATOMIC_RELAXED);
+}
+
+
+// Get the level used by a game: the games of lower priority are degraded
+// first
+int get_game_degradation_level(EngineScheduler* scheduler, int priority) {
+    return max(
+        0, 
+        get_degradation_level(scheduler) - (SCHEDULER_PRIORITIES - 1 - priority)
+    );
+}
+
+
+// Get the budgets of a degradation level
+// Level 1 searches two heights less, level 2 half the height and level 3
+// the minimum height. The node limit (if any) is divided by 4 per level.
+void get_degraded_config(
+    EngineConfig* base_config, 
+    int level, 
+    EngineConfig* config
+) {
+    *config = *base_config;
+    int height = base_config->max_height;
+    if (level == 1) {
+        height -= 2;
+    } else if (level == 2) {
+        height /= 2;
+    } else if (level >= 3) {
+        height = SCHEDULER_MIN_HEIGHT;
+    }
+    config->max_height = max(
+        height, 
+        min(base_config->max_height, SCHEDULER_MIN_HEIGHT)
+    );
+    if (base_config->max_nodes > 0) {
+        config->max_nodes = max(1, base_config->max_nodes >> (2 * level));
+    }
+    return;
+}
+
+
+// Finish a move played on a level, with its latency (microseconds, waiting
+// included), and change the active level if needed
+// The level goes up as soon as the queue or the recent latency is over the
+// limit and down when both are well below it. It goes down at most once
+// every SCHEDULER_HOLD_MOVES moves, so a burst does not make it oscillate
+void finish_scheduled_move(
+    EngineScheduler* scheduler, 
+    int level, 
+    uint64_t latency
+) {
+    pthread_mutex_lock(&(scheduler->mutex));
+    scheduler->queued--;
+    scheduler->recent_latency += SCHEDULER_LATENCY_WEIGHT * (
+        (double) latency - scheduler->recent_latency
+    );
+    scheduler->level_moves[level]++;
+    record_latency(&(scheduler->latency), latency);
+
+    scheduler->moves_since_change++;
+    bool overloaded = (
+        scheduler->recent_latency > scheduler->target_latency 
+        || scheduler->queued > scheduler->max_queued
+    );
+    bool underloaded = (
+        scheduler->recent_latency < scheduler->target_latency / 2 
+        && scheduler->queued <= scheduler->max_queued
+    );
+    int new_level = scheduler->level;
+    if (overloaded && new_level < SCHEDULER_LEVELS - 1) {
+        new_level++;
+    } else if (
+        underloaded 
+        && new_level > 0 
+        && scheduler->moves_since_change >= SCHEDULER_HOLD_MOVES
+    ) {
+        new_level--;
+    }
+    if (new_level != scheduler->level) {
+        __atomic_store_n(&(scheduler->level), new_level, __ATOMIC_RELAXED);
+        scheduler->moves_since_change = 0;
+    }
+    pthread_mutex_unlock(&(scheduler->mutex));
+    return;
+}
+
+
+// Play the next move of a game of the load test
+void play_load_move(void* context, int item, int worker) {
+    LoadTest* test = (LoadTest*) context;
+    EngineScheduler* scheduler = &(test->scheduler);
+    LoadGame* game = &(test->games[test->active[item]]);
+    Board* board = game->board;
+    Engine* engine = test->engines[worker];
+
+    int level = get_game_degradation_level(scheduler, game->priority);
+    get_degraded_config(&(scheduler->base_config), level, &(engine->config));
+    board->turn_player = (board->ply % 2 == 0) ? id_player_1 : id_player_2;
+    int opponent_id = (
+        (board->turn_player == id_player_1) ? id_player_2 : id_player_1
+    );
+    Move* move = get_computer_move(
+        engine, 
+        board, 
+        opponent_id, 
+        board->turn_player, 
+        test->adj_matrix
+    );
+
+    // A player without valid moves ends the game as a draw
+    if (move == NULL) {
+        game->finished = true;
+    } else {
+        make_move(board, *move, test->adj_matrix);
+        free_tracked(move);
+        if (player_is_winner(board)) {
+            board->winner = board->turn_player;
+        }
+        game->finished = (
+            board->winner != id_empty || board->ply >= MAX_TURNS * 2
+        );
+    }
+    finish_scheduled_move(
+        scheduler, 
+        level, 
+        get_time_microseconds() - test->request_time
+    );
+    return;
+}
+
+
+// Play games of the computer against itself, all of them asking for a move
+// at the same time on each round, with the budgets chosen by the scheduler
+// The games have priorities 0, 1, 2, 0, ... The level is shown whenever it
+// changes, and the latency of the moves and the moves of each level at the
+// end
+void run_load_test(
+    int num_games, 
+    int num_threads, 
+    uint64_t seed, 
+    EngineConfig* config, 
+    uint64_t target_latency
+) {
+    uint64_t start_time = get_time_microseconds();
+    LoadTest* test = (LoadTest*) malloc(sizeof(LoadTest));
+    init_engine_scheduler(
+        &(test->scheduler), 
+        config, 
+        target_latency, 
+        num_threads
+    );
+    // The engines of the workers play moves of unrelated games, so they can
+    // not keep the tree between moves (every move gets a degraded copy of
+    // the base configuration)
+    test->scheduler.base_config.reuse_tree = false;
+    test->games = (LoadGame*) malloc(sizeof(LoadGame) * num_games);
+    test->active = (int*) malloc(sizeof(int) * num_games);
+    for (int i = 0; i < num_games; i++) {
+        test->games[i].board = create_board();
+        test->games[i].priority = i % SCHEDULER_PRIORITIES;
+        test->games[i].finished = false;
+    }
+    test->adj_matrix = create_adjacency_matrix(NUM_NODES);
+    test->engines = (Engine**) malloc(sizeof(Engine*) * num_threads);
+    for (int i = 0; i < num_threads; i++) {
+        test->engines[i] = create_engine(
+            seed + i, 
+            &(test->scheduler.base_config)
+        );
+    }
+    ThreadPool* pool = create_thread_pool(num_threads);
+
+    int shown_level = 0;
+    int num_active = num_games;
+    for (int round = 1; num_active > 0; round++) {
+        num_active = 0;
+        for (int i = 0; i < num_games; i++) {
+            if (!test->games[i].finished) {
+                test->active[num_active++] = i;
+            }
+        }
+        if (num_active == 0) {
+            break;
+        }
+        request_scheduled_moves(&(test->scheduler), num_active);
+        test->request_time = get_time_microseconds();
+        thread_pool_run(pool, play_load_move, test, num_active);
+
+        int level = get_degradation_level(&(test->scheduler));
+        if (level != shown_level) {
+            printf(
+                "Jogada %d: nivel %d (%d partidas, latencia recente "
+                "%.1f ms)\n", 
+                round, 
+                level, 
+                num_active, 
+                test->scheduler.recent_latency / 1000.0
+            );
+            shown_level = level;
+        }
+    }
+    delete_thread_pool(pool);
+
+    int wins[3] = {0, 0, 0};
+    for (int i = 0; i < num_games; i++) {
+        wins[test->games[i].board->winner]++;
+    }
+    printf(
+        "%d partidas em %.3f s: vitorias de %c: %d, vitorias de %c: %d, "
+        "empates: %d\n",
+        num_games, 
+        (get_time_microseconds() - start_time) / 1e6, 
+        PLAYER_1, wins[id_player_1], PLAYER_2, wins[id_player_2], 
+        wins[id_empty]
+    );
+    printf("Jogadas por nivel:");
+    for (int level = 0; level < SCHEDULER_LEVELS; level++) {
+        EngineConfig degraded;
+        get_degraded_config(config, level, &degraded);
+        printf(
+            " %d (altura %d): %lld%s", 
+            level, 
+            degraded.max_height, 
+            test->scheduler.level_moves[level], 
+            (level < SCHEDULER_LEVELS - 1) ? "," : "\n"
+        );
+    }
+    printf("Nivel ativo: %d\n", get_degradation_level(&(test->scheduler)));
+    printf("Latencia das jogadas com a espera (microssegundos):\n");
+    printf(
+        "%-12s %8s %10s %10s %10s %10s\n", 
+        "", "jogadas", "p50", "p90", "p99", "max"
+    );
+    print_latency_line("total", &(test->scheduler.latency));
+
+    // Free the allocated memory
+    for (int i = 0; i < num_threads; i++) {
+        delete_engine(test->engines[i]);
+    }
+    for (int i = 0; i < num_games; i++) {
+        delete_board(test->games[i].board);
+    }
+    delete_adjacency_matrix(test->adj_matrix);
+    destroy_engine_scheduler(&(test->scheduler));
+    free(test->engines);
+    free(test->active);
+    free(test->games);
+    free(test);
+    return;
+}
+
+
+// **********
+// Game snapshot functions
+// A snapshot has GAME_SNAPSHOT_SIZE bytes (numbers in little-endian):
+// mode, turn player, round, winner, engine type, maximum height, use of
+// the evaluation, reuse of the tree (1 byte each), evaluation weights
+// (2 bytes each), node limit (4 bytes), seed of the record (8 bytes),
+// state of the random number generator (4 * 8 bytes), cells (1 byte each),
+// number of moves and the moves of the record (1 byte each)
+
+// Write the lowest num_bytes bytes of a number (little-endian)
+void store_little_endian(unsigned char* out, uint64_t value, int num_bytes) {
+    for (int i = 0; i < num_bytes; i++) {
+        out[i] = (unsigned char) (value >> (8 * i));
+    }
+    return;
+}
+
+
+// Read a number of num_bytes bytes (little-endian)
+uint64_t load_little_endian(const unsigned char* in, int num_bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < num_bytes; i++) {
+        value |= (uint64_t) in[i] << (8 * i);
+    }
+    return value;
+}
+
+
+// Write the snapshot of a game
+void snapshot_game(Game* game, unsigned char* out) {
+    memset(out, 0, GAME_SNAPSHOT_SIZE);
+    Engine* engine = game->engine;
+    Board* board = game->board;
+    out[0] = (unsigned char) game->mode;
+    out[1] = (unsigned char) board->turn_player;
+    out[2] = (unsigned char) (board->ply / 2);
+    out[3] = (unsigned char) board->winner;
+    if (get_computer_player(game->mode) != id_empty) {
+        EngineConfig* config = &(engine->config);
+        out[4] = (unsigned char) config->type;
+        out[5] = (unsigned char) config->max_height;
+        out[6] = (unsigned char) config->use_evaluation;
+        out[7] = (unsigned char) config->reuse_tree;
+        for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+            store_little_endian(
+                out + 8 + 2 * i, 
+                (uint16_t) config->eval_weights[i], 
+                2
+            );
+        }
+        store_little_endian(out + 16, (uint32_t) config->max_nodes, 4);
+        for (int i = 0; i < 4; i++) {
+            store_little_endian(out + 28 + 8 * i, engine->rng.state[i], 8);
+        }
+    }
+    store_little_endian(out + 20, game->record.seed, 8);
+    get_board_cells(board, out + 60);
+    out[69] = (unsigned char) game->record.num_moves;
+    memcpy(out + 70, game->record.moves, game->record.num_moves);
+    return;
+}
+
+
+// Check the values of a snapshot
+bool is_valid_game_snapshot(const unsigned char* in) {
+    int num_moves = in[69];
+    int num_pieces[3] = {0, 0, 0};
+    for (int node = 0; node < NUM_NODES; node++) {
+        num_pieces[min(in[60 + node], id_empty)]++;
+    }
+    return (
+        in[0] < NUM_GAME_MODES 
+        && in[1] <= id_player_2 
+        && in[3] <= id_empty 
+        && num_moves <= MAX_RECORD_MOVES 
+        && in[2] == num_moves / 2 
+        && num_pieces[id_player_1] == NUM_PIECES 
+        && num_pieces[id_player_2] == NUM_PIECES 
+        && in[4] <= engine_fast
+    );
+}
+
+
+// Start a game from a snapshot
+// The engine receives the settings and the random number generator of the
+// computer player of the game
+// Returns false (without starting the game) if the snapshot is not valid
+bool restore_game(Game* game, const unsigned char* in, Engine* engine) {
+    if (!is_valid_game_snapshot(in)) {
+        return false;
+    }
+
+    int num_moves = in[69];
+    GameMode mode = (GameMode) in[0];
+    init_game(
+        game, 
+        mode, 
+        load_little_endian(in + 20, 8), 
+        (get_computer_player(mode) != id_empty) ? engine : NULL
+    );
+    Board* board = game->board;
+    for (int node = 0; node < NUM_NODES; node++) {
+        board->table[node / board->size][node % board->size] = in[60 + node];
+    }
+    // Player 1 plays on even moves and player 2 on odd moves
+    board->turn_player = (num_moves % 2 == 0) ? id_player_1 : id_player_2;
+    board->winner = in[3];
+    board->ply = num_moves;
+    game->record.num_moves = num_moves;
+    memcpy(game->record.moves, in + 70, num_moves);
+
+    if (get_computer_player(game->mode) != id_empty) {
+        EngineConfig* config = &(engine->config);
+        config->type = (EngineType) in[4];
+        config->max_height = in[5];
+        config->use_evaluation = in[6];
+        config->reuse_tree = in[7];
+        for (int i = 0; i < NUM_EVAL_FEATURES; i++) {
+            config->eval_weights[i] = (int16_t) load_little_endian(
+                in + 8 + 2 * i, 
+                2
+            );
+        }
+        config->max_nodes = (int) load_little_endian(in + 16, 4);
+        clear_engine_tree(engine);
+        for (int i = 0; i < 4; i++) {
+            engine->rng.state[i] = load_little_endian(in + 28 + 8 * i, 8);
+        }
+    }
+    update_game_status(game);
+    return true;
+}
+
+
+// Write the snapshots of the live games to a file: the current game (if
+// not NULL) and then the waiting games
+// The file is replaced only after the new one is complete, so a restart
+// always finds a whole file
+// Returns false if the file can not be written
+bool save_live_games(
+    const char* path, 
+    const unsigned char* current, 
+    const unsigned char* waiting, 
+    int num_waiting
+) {
+    char* temp_path = (char*) malloc(
+        strlen(path) + strlen(SNAPSHOT_TEMP_SUFFIX) + 1
+    );
+    sprintf(temp_path, "%s%s", path, SNAPSHOT_TEMP_SUFFIX);
+    FILE* file = fopen(temp_path, "wb");
+    if (file == NULL) {
+        free(temp_path);
+        return false;
+    }
+
+    unsigned char header[SNAPSHOT_HEADER_SIZE];
+    memcpy(header, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE);
+    header[SNAPSHOT_MAGIC_SIZE] = SNAPSHOT_VERSION;
+    store_little_endian(
+        header + SNAPSHOT_MAGIC_SIZE + 1, 
+        num_waiting + (current != NULL), 
+        4
+    );
+    bool written = fwrite(header, 1, SNAPSHOT_HEADER_SIZE, file) 
+        == SNAPSHOT_HEADER_SIZE;
+    if (current != NULL) {
+        written = written 
+            && fwrite(current, 1, GAME_SNAPSHOT_SIZE, file) 
+                == GAME_SNAPSHOT_SIZE;
+    }
+    size_t waiting_size = (size_t) num_waiting * GAME_SNAPSHOT_SIZE;
+    written = written 
+        && fwrite(waiting, 1, waiting_size, file) == waiting_size;
+    written = (fflush(file) == 0) && written;
+    written = (fsync(fileno(file)) == 0) && written;
+    written = (fclose(file) == 0) && written;
+    written = written && (rename(temp_path, path) == 0);
+    free(temp_path);
+    return written;
+}
+
+
+// Read the snapshots of a file with a single read
+// Returns the snapshots (NULL if the file is not valid)
+unsigned char* load_game_snapshots(const char* path, int* num_snapshots) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    unsigned char header[SNAPSHOT_HEADER_SIZE];
+    bool valid = (
+        fread(header, 1, SNAPSHOT_HEADER_SIZE, file) == SNAPSHOT_HEADER_SIZE 
+        && memcmp(header, SNAPSHOT_MAGIC, SNAPSHOT_MAGIC_SIZE) == 0 
+        && header[SNAPSHOT_MAGIC_SIZE] == SNAPSHOT_VERSION
+    );
+    unsigned char* snapshots = NULL;
+    if (valid) {
+        *num_snapshots = (int) load_little_endian(
+            header + SNAPSHOT_MAGIC_SIZE + 1, 
+            4
+        );
+        size_t size = (size_t) *num_snapshots * GAME_SNAPSHOT_SIZE;
+        // At least one byte, so an empty file is not an error
+        snapshots = (unsigned char*) malloc(size + 1);
+        if (fread(snapshots, 1, size, file) != size) {
+            free(snapshots);
+            snapshots = NULL;
+        }
+    }
+    fclose(file);
+    return snapshots;
+}
+
+
+// Play the games of a snapshot file, one after the other
+// All the snapshots are read and checked at once; the board of each game is
+// created when the game starts. The checkpoint file (if any) keeps the
+// games not finished.
+// Returns false if the file is not valid
+bool resume_games(const char* path, GameSettings* settings) {
+    uint64_t start_time = get_time_microseconds();
+    int num_snapshots = 0;
+    unsigned char* snapshots = load_game_snapshots(path, &num_snapshots);
+    if (snapshots == NULL) {
+        printf("Arquivo de partidas salvas invalido: %s\n", path);
+        return false;
+    }
+
+    // Keep only the valid snapshots
+    int num_games = 0;
+    for (int i = 0; i < num_snapshots; i++) {
+        unsigned char* snapshot = snapshots + (size_t) i * GAME_SNAPSHOT_SIZE;
+        if (is_valid_game_snapshot(snapshot)) {
+            memmove(
+                snapshots + (size_t) num_games * GAME_SNAPSHOT_SIZE, 
+                snapshot, 
+                GAME_SNAPSHOT_SIZE
+            );
+            num_games++;
+        } else {
+            printf("Partida salva %d invalida, ignorada.\n", i + 1);
+        }
+    }
+    printf(
+        "Partidas restauradas: %d (%.3f ms)\n", 
+        num_games, 
+        (get_time_microseconds() - start_time) / 1000.0
+    );
+
+    for (int i = 0; i < num_games; i++) {
+        Game game;
+        restore_game(
+            &game, 
+            snapshots + (size_t) i * GAME_SNAPSHOT_SIZE, 
+            settings->engine
+        );
+        settings->waiting_games = (
+            snapshots + (size_t) (i + 1) * GAME_SNAPSHOT_SIZE
+        );
+        settings->num_waiting_games = num_games - i - 1;
+        printf("Partida salva %d de %d\n", i + 1, num_games);
+        play_game(&game, settings);
+        delete_game(&game);
+    }
+    settings->waiting_games = NULL;
+    settings->num_waiting_games = 0;
+
+    free(snapshots);
+    return true;
+}
+
+
+// **********
+// Spectator functions
+// Each event is written once on a ring and every spectator reads it in
+// place, so the cost of publishing does not depend on the number of
+// spectators. A spectator that falls behind skips to the latest event.
+
+// Create a feed and start the threads of its spectators
+// The spectators are shared by the threads, so waking them costs the same
+// for any number of spectators
+// The first spectator writes the frames on the output (if not NULL)
+SpectatorFeed* create_spectator_feed(
+    int num_spectators, 
+    int num_threads, 
+    FILE* output
+) {
+    SpectatorFeed* feed = (SpectatorFeed*) calloc(1, sizeof(SpectatorFeed));
+    pthread_mutex_init(&(feed->mutex), NULL);
+    pthread_cond_init(&(feed->event_ready), NULL);
+    feed->num_spectators = num_spectators;
+    feed->spectators = (Spectator*) calloc(
+        max(1, num_spectators), 
+        sizeof(Spectator)
+    );
+    for (int i = 0; i < num_spectators; i++) {
+        Spectator* spectator = &(feed->spectators[i]);
+        spectator->feed = feed;
+        spectator->next_sequence = 1;
+        spectator->output = (i == 0) ? output : NULL;
+    }
+
+    feed->num_threads = max(1, min(num_threads, num_spectators));
+    feed->threads = (SpectatorThread*) calloc(
+        feed->num_threads, 
+        sizeof(SpectatorThread)
+    );
+    for (int i = 0; i < feed->num_threads; i++) {
+        SpectatorThread* thread = &(feed->threads[i]);
+        thread->feed = feed;
+        thread->index = i;
+        pthread_create(&(thread->thread), NULL, run_spectators, thread);
+    }
+    return feed;
+}
+
+
+// Publish an event with the position of the board
+// The move is encoded as origin * 9 + destiny (SPECTATOR_NO_MOVE for none)
+void publish_spectator_event(
+    SpectatorFeed* feed, 
+    SpectatorEventType type, 
+    Board* board, 
+    int move
+) {
+    uint64_t start_time = get_time_nanoseconds();
+    uint64_t sequence = feed->published + 1;
+    SpectatorEvent* event = &(
+        feed->events[sequence % SPECTATOR_RING_SIZE]
+    );
+    // The spectators still reading the old event see it changed
+    __atomic_store_n(&(event->sequence), 0, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (type == spectator_game_start) {
+        feed->num_games++;
+    }
+    event->type = type;
+    event->game = feed->num_games;
+    get_board_cells(board, event->cells);
+    event->turn_player = (unsigned char) board->turn_player;
+    event->ply = (unsigned char) board->ply;
+    event->winner = (unsigned char) board->winner;
+    event->move = (unsigned char) move;
+
+    int length = 0;
+    if (type == spectator_game_start) {
+        length += sprintf(event->frame, "Partida %d\n", event->game);
+    } else if (type == spectator_move) {
+        Move played = decode_move(event->move);
+        length += sprintf(
+            event->frame, 
+            "Partida %d, jogada %d: (%d, %d) -> (%d, %d)\n", 
+            event->game, 
+            board->ply, 
+            played.origin.row, 
+            played.origin.col, 
+            played.destiny.row, 
+            played.destiny.col
+        );
+    } else if (board->winner == id_empty) {
+        length += sprintf(event->frame, "Partida %d: empate\n", event->game);
+    } else {
+        length += sprintf(
+            event->frame, 
+            "Partida %d: vitoria de %c\n", 
+            event->game, 
+            get_symbol_from_player(board->winner)
+        );
+    }
+    length += render_board(board, event->frame + length);
+    event->frame_length = length;
+
+    __atomic_store_n(&(event->sequence), sequence, __ATOMIC_RELEASE);
+    __atomic_store_n(&(feed->published), sequence, __ATOMIC_RELEASE);
+    // The time does not include the wake up, where a woken thread may take
+    // the processor
+    feed->publish_time += get_time_nanoseconds() - start_time;
+
+    // A single call wakes all the threads of the spectators
+    pthread_mutex_lock(&(feed->mutex));
+    pthread_cond_broadcast(&(feed->event_ready));
+    pthread_mutex_unlock(&(feed->mutex));
+    return;
+}
+
+
+// Get the next event of a spectator without waiting
+// A spectator too far behind skips to the latest event
+// Returns the event on the ring (not a copy) or NULL if there is no new event
+const SpectatorEvent* read_spectator_event(Spectator* spectator) {
+    SpectatorFeed* feed = spectator->feed;
+    uint64_t published = __atomic_load_n(&(feed->published), __ATOMIC_ACQUIRE);
+    if (spectator->next_sequence > published) {
+        return NULL;
+    }
+
+    if (published - spectator->next_sequence >= SPECTATOR_MAX_LAG) {
+        spectator->events_skipped += published - spectator->next_sequence;
+        spectator->next_sequence = published;
+    }
+    return &(feed->events[spectator->next_sequence % SPECTATOR_RING_SIZE]);
+}
+
+
+// Finish reading an event of read_spectator_event
+// Returns false if the event was overwritten while it was read (what was
+// read must be discarded; the next read skips to the latest event)
+bool finish_spectator_event(
+    Spectator* spectator, 
+    const SpectatorEvent* event
+) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    bool valid = (
+        __atomic_load_n(&(event->sequence), __ATOMIC_ACQUIRE) 
+        == spectator->next_sequence
+    );
+    if (valid) {
+        spectator->events_read++;
+    } else {
+        spectator->events_skipped++;
+    }
+    spectator->next_sequence++;
+    return valid;
+}
+
+
+// Wait for an event after the last one read
+// Returns the number of the last event published (last_read if the feed
+// was closed)
+uint64_t wait_spectator_events(SpectatorFeed* feed, uint64_t last_read) {
+    pthread_mutex_lock(&(feed->mutex));
+    uint64_t published = __atomic_load_n(&(feed->published), __ATOMIC_ACQUIRE);
+    while (published <= last_read && !feed->closed) {
+        pthread_cond_wait(&(feed->event_ready), &(feed->mutex));
+        published = __atomic_load_n(&(feed->published), __ATOMIC_ACQUIRE);
+    }
+    pthread_mutex_unlock(&(feed->mutex));
+    return published;
+}
+
+
+// Thread of the spectators: read the events of each spectator until the
+// feed is closed
+void* run_spectators(void* arg) {
+    SpectatorThread* thread = (SpectatorThread*) arg;
+    SpectatorFeed* feed = thread->feed;
+    uint64_t last_read = 0;
+    uint64_t published = wait_spectator_events(feed, last_read);
+    while (published > last_read) {
+        for (int i = thread->index; i < feed->num_spectators; 
+            i += feed->num_threads) {
+            Spectator* spectator = &(feed->spectators[i]);
+            const SpectatorEvent* event = read_spectator_event(spectator);
+            while (event != NULL) {
+                if (spectator->output == NULL) {
+                    finish_spectator_event(spectator, event);
+                    event = read_spectator_event(spectator);
+                    continue;
+                }
+                // The writer may overwrite the event while it is read, so
+                // the frame is copied and written only if it is still valid
+                char frame[SPECTATOR_FRAME_SIZE];
+                int length = __atomic_load_n(
+                    &(event->frame_length), 
+                    __ATOMIC_RELAXED
+                );
+                length = min(max(length, 0), SPECTATOR_FRAME_SIZE);
+                memcpy(frame, event->frame, length);
+                if (finish_spectator_event(spectator, event)) {
+                    fwrite(frame, 1, length, spectator->output);
+                }
+                event = read_spectator_event(spectator);
+            }
+            if (spectator->output != NULL) {
+                fflush(spectator->output);
+            }
+        }
+        last_read = published;
+        published = wait_spectator_events(feed, last_read);
+    }
+    return NULL;
+}
+
+
+// Stop the spectators after they read the last events, show what they read
+// and free the feed
+void close_spectator_feed(SpectatorFeed* feed) {
+    pthread_mutex_lock(&(feed->mutex));
+    feed->closed = true;
+    pthread_cond_broadcast(&(feed->event_ready));
+    pthread_mutex_unlock(&(feed->mutex));
+
+    for (int i = 0; i < feed->num_threads; i++) {
+        pthread_join(feed->threads[i].thread, NULL);
+    }
+    long long events_read = 0;
+    long long events_skipped = 0;
+    for (int i = 0; i < feed->num_spectators; i++) {
+        events_read += feed->spectators[i].events_read;
+        events_skipped += feed->spectators[i].events_skipped;
+    }
+    printf(
+        "Espectadores: %d, eventos publicados: %llu (%.3f us por evento), "
+        "lidos: %lld, pulados: %lld\n", 
+        feed->num_spectators, 
+        (unsigned long long) feed->published, 
+        (feed->published > 0) 
+            ? feed->publish_time / 1000.0 / feed->published : 0.0, 
+        events_read, 
+        events_skipped
+    );
+
+    pthread_mutex_destroy(&(feed->mutex));
+    pthread_cond_destroy(&(feed->event_ready));
+    free(feed->spectators);
+    free(feed->threads);
+    free(feed);
+    return;
+}
+
+
+// **********
+// Game functions
+
+// Check a win on a row
+bool win_by_row(Board* board, int row) {
+    // Check if all pieces in the row are the same as the turn player
+    for (int j = 0; j < board->size; j++) {
+        // If there is a position without the turn player, it is not a win
+        if (board->table[row][j] != board->turn_player) {
+            return false; 
+        }
+    }
+    return true;
+}
+
+
+// Check a win on a column
+bool win_by_column(Board* board, int col) {
+    // Check if all pieces in the column are the same as the turn player
+    for (int i = 0; i < board->size; i++) {
+        // If there is a position without the turn player, it is not a win
+        if (board->table[i][col] != board->turn_player) {
+            return false; 
+        }
+    }
+    // If all positions have the same player, it is a win
+    return true;
+}
+
+
+// Check main diagonal
+bool win_by_main_diagonal(Board* board) {
+    // Check if all pieces in the main diagonal are the same as the turn player
     for (int i = 0; i < board->size; i++) {
         // If there is a position without the turn player, it is not a win
         if (board->table[i][i] != board->turn_player) {
@@ -1394,109 +9507,261 @@ bool player_is_winner(Board* board) {
 }
 
 
-// Play a turn for the player
-void play_user_turn(Board* board, AdjacencyMatrix* adj_matrix) {
-    // Try to play a turn until a valid move is made
+// Start a game on the initial position
+// The engine is the computer player (NULL on player vs player)
+void init_game(Game* game, GameMode mode, uint64_t seed, Engine* engine) {
+    game->mode = mode;
+    game->board = create_board();
+    game->board->turn_player = id_player_1;
+    game->adj_matrix = create_adjacency_matrix(NUM_NODES);
+    game->engine = engine;
+    init_game_record(&(game->record), VARIANT_CLASSIC, seed);
+    memset(&(game->last_move), 0, sizeof(Move));
+    update_game_status(game);
+    return;
+}
+
+
+// Free the board of the game
+void delete_game(Game* game) {
+    delete_board(game->board);
+    delete_adjacency_matrix(game->adj_matrix);
+    return;
+}
+
+
+// Get the id of the computer player of a game mode (id_empty for none)
+int get_computer_player(GameMode mode) {
+    if (mode == game_player_vs_computer) {
+        return id_player_2;
+    }
+    if (mode == game_computer_vs_player) {
+        return id_player_1;
+    }
+    return id_empty;
+}
+
+
+// Find out who plays next from the board of the game
+// The game ends with a winner, after the last round or when the turn player
+// has no valid moves (a draw, as on the games of the computer against itself)
+void update_game_status(Game* game) {
+    Board* board = game->board;
+    if (
+        board->winner != id_empty 
+        || board->ply >= MAX_TURNS * 2 
+        || count_valid_moves(board, board->turn_player, game->adj_matrix) == 0
+    ) {
+        game->status = game_finished;
+    } else if (board->turn_player == get_computer_player(game->mode)) {
+        game->status = game_waiting_computer;
+    } else {
+        game->status = game_waiting_player;
+    }
+    return;
+}
+
+
+// Get the state of a game
+GameStatus get_game_status(Game* game) {
+    return game->status;
+}
+
+
+// Finish the turn of a move already made on the board
+void end_game_turn(Game* game, Move move) {
+    Board* board = game->board;
+    add_move_to_record(&(game->record), move);
+    game->last_move = move;
+
+    // Verify if the player has won
+    if (player_is_winner(board)) {
+        board->winner = board->turn_player;
+    } else {
+        board->turn_player = (
+            (board->turn_player == id_player_1) ? id_player_2 : id_player_1
+        );
+    }
+    update_game_status(game);
+    return;
+}
+
+
+// Play a move of the person whose turn it is
+// Never blocks: returns move_ok if the move was played or the reason it was
+// refused (the game does not change)
+MoveError submit_move(Game* game, Move move) {
+    if (game->status == game_finished) {
+        return move_game_over;
+    }
+    if (game->status == game_waiting_computer) {
+        return move_not_player_turn;
+    }
+
+    MoveError error = make_move(game->board, move, game->adj_matrix);
+    if (error == move_ok) {
+        end_game_turn(game, move);
+    }
+    return error;
+}
+
+
+// Play the move of the computer if it is its turn
+// Returns true if a move was played (the move is on game->last_move)
+bool step_game(Game* game) {
+    if (game->status != game_waiting_computer) {
+        return false;
+    }
+
+    Board* board = game->board;
+    int computer_id = board->turn_player;
+    int player_id = (computer_id == id_player_1) ? id_player_2 : id_player_1;
+    Move* move = get_computer_move(
+        game->engine,
+        board, 
+        player_id,
+        computer_id,
+        game->adj_matrix
+    );
+    // The game is over before a turn without valid moves, but a search
+    // without a move must not leave the game waiting forever
+    if (move == NULL) {
+        game->status = game_finished;
+        return false;
+    }
+
+    make_move(board, *move, game->adj_matrix);
+    end_game_turn(game, *move);
+    free_tracked(move);
+    return true;
+}
+
+
+// Play a turn for the player reading the move from the user
+// Asks again until a valid move is made
+void play_user_turn(Game* game) {
+    Board* board = game->board;
     printf(
         "Jogador %c, é sua vez de jogar.\n", 
         get_symbol_from_player(board->turn_player)
     );
 
-    bool turn_played = false;
-    while (!turn_played) {
+    MoveError error = move_not_player_turn;
+    while (error != move_ok) {
         // Get the player's move
-        Position old_pos;
-        Position new_pos;
         Move* move = get_player_move(board->turn_player);
         // Make the move if valid
-        make_move(board, *move, &turn_played, adj_matrix);
-        free(move);
+        error = submit_move(game, *move);
+        free_tracked(move);
+        if (error != move_ok) {
+            printf(
+                "\n** MOVIMENTO INVALIDO: %s Tente novamente.\n\n", 
+                get_move_error_message(error)
+            );
+        }
     }
     return;
 }
 
-void play_computer_turn(
-    Board* board, 
-    int player_id, 
-    int computer_id,
-    AdjacencyMatrix* adjacency_matrix
-) {
+
+// Play a turn for the computer and show its move
+void play_computer_turn(Game* game) {
     printf(
         "É a vez do computador (%c).\n", 
-        get_symbol_from_player(board->turn_player)
-    );
-    // Get the computer move
-    Move* move = get_computer_move(
-        board, 
-        player_id,
-        computer_id,
-        adjacency_matrix
+        get_symbol_from_player(game->board->turn_player)
     );
+    if (step_game(game)) {
+        Move* move = &(game->last_move);
+        printf("Computador jogou: (%d, %d) -> (%d, %d)\n",
+            move->origin.row, move->origin.col,
+            move->destiny.row, move->destiny.col
+        );
+    }
+    return;
+}
 
-    printf("Computador jogou: (%d, %d) -> (%d, %d)\n",
-        move->origin.row, move->origin.col,
-        move->destiny.row, move->destiny.col
-    );
 
-    // Make the move
-    bool move_played = false;
-    if (move != NULL) {
-        make_move(board, *move, &move_played, adjacency_matrix);
-        free(move);
-    } else {
-        printf("Erro: Nenhum movimento valido encontrado.\n");
-        exit(1);
+// Save the game and the waiting games on the checkpoint file
+void checkpoint_game(Game* game, GameSettings* settings) {
+    unsigned char snapshot[GAME_SNAPSHOT_SIZE];
+    bool finished = (get_game_status(game) == game_finished);
+    if (!finished) {
+        snapshot_game(game, snapshot);
+    }
+    bool saved = save_live_games(
+        settings->checkpoint_path, 
+        finished ? NULL : snapshot, 
+        settings->waiting_games, 
+        settings->num_waiting_games
+    );
+    if (!saved) {
+        printf(
+            "Nao foi possivel salvar as partidas em %s.\n", 
+            settings->checkpoint_path
+        );
     }
     return;
 }
 
 
-// Implement player vs player logic
-void player_vs_player() {
-    printf("Player vs Player\n");
-    
-    // Initialize board
-    Board* board = create_board();
-    AdjacencyMatrix* adj_matrix = create_adjacency_matrix(NUM_NODES);
+// Play a game until the end, starting from its current position
+// The moves of the user are read from the standard input
+void play_game(Game* game, GameSettings* settings) {
+    Board* board = game->board;
 
     // Show board
-    print_board(board);
-    
-    // Initialize game related varibles
-    bool winner_found = false;
-    int num_rounds = MAX_TURNS;
+    print_board(board, settings->renderer);
+    if (settings->spectators != NULL) {
+        publish_spectator_event(
+            settings->spectators, 
+            spectator_game_start, 
+            board, 
+            SPECTATOR_NO_MOVE
+        );
+    }
+
     // While there is no winner and rounds are not over
-    for (int i = 0; i < num_rounds && !winner_found; i++) {
-        printf("Rodada %d\n", i + 1);
-        
-        // Player 1 plays on even rounds, Player 2 on odd rounds.
-        board->turn_player = id_player_1;
-        // Make the player's turn
-        play_user_turn(board, adj_matrix);
-        // Verify if the player has won
-        winner_found = player_is_winner(board);
-        int winner = (winner_found) ? board->turn_player : id_empty;
-
-        // If no winner found, second player plays
-        // If a winner is found, the game ends
-        if (!winner_found) {
-            print_board(board);
-            // Change turn player
-            board->turn_player = id_player_2;
-            // Make the player's turn
-            play_user_turn(board, adj_matrix);
-            // Verify if the player has won
-            winner_found = player_is_winner(board);
-            winner = (winner_found) ? board->turn_player : id_empty;
+    while (get_game_status(game) != game_finished) {
+        if (settings->checkpoint_path != NULL) {
+            checkpoint_game(game, settings);
+        }
+        if (board->turn_player == id_player_1) {
+            printf("Rodada %d\n", board->ply / 2 + 1);
         }
-        // If a winner is found, set the winner
-        if (winner_found) {
-            board->winner = winner;
+
+        if (get_game_status(game) == game_waiting_computer) {
+            // Make the computer's turn
+            play_computer_turn(game);
+        } else {
+            // Make the player's turn
+            play_user_turn(game);
         }
 
-        // Print the board after the turn
-        print_board(board);
+        // Print the board after the move
+        print_board(board, settings->renderer);
+        if (settings->spectators != NULL) {
+            publish_spectator_event(
+                settings->spectators, 
+                spectator_move, 
+                board, 
+                encode_move(game->last_move)
+            );
+        }
+    }
+    if (settings->spectators != NULL) {
+        publish_spectator_event(
+            settings->spectators, 
+            spectator_game_end, 
+            board, 
+            SPECTATOR_NO_MOVE
+        );
     }
+    // The finished game leaves the checkpoint file
+    if (settings->checkpoint_path != NULL) {
+        checkpoint_game(game, settings);
+    }
+
+    reset_board_renderer(settings->renderer);
 
     // Print the winner
     if (board->winner == id_empty) {
@@ -1504,90 +9769,195 @@ void player_vs_player() {
     } else {
         printf("Jogador %c venceu!\n", get_symbol_from_player(board->winner));
     }
-    
-    // Free the allocated memory for the board
-    delete_board(board);
-    delete_adjacency_matrix(adj_matrix);
+
+    // Record the finished game
+    if (settings->record_writer != NULL) {
+        game->record.result = board->winner;
+        write_game_record(settings->record_writer, &(game->record));
+    }
+    return;
+}
+
+
+// Implement player vs player logic
+void player_vs_player(GameSettings* settings) {
+    printf("Player vs Player\n");
+
+    Game game;
+    init_game(&game, game_player_vs_player, settings->seed, NULL);
+    play_game(&game, settings);
+    delete_game(&game);
     return;
 }
 
 
 // Implement player vs computer logic
-void player_vs_computer(bool player_starts) {
+void player_vs_computer(bool player_starts, GameSettings* settings) {
     printf("Player vs Computer\n");
-    
-    // Define player ids
-    int player_id = (player_starts) ? id_player_1 : id_player_2;
-    int computer_id = (player_starts) ? id_player_2 : id_player_1;
 
+    Game game;
+    init_game(
+        &game, 
+        player_starts ? game_player_vs_computer : game_computer_vs_player, 
+        settings->seed, 
+        settings->engine
+    );
+    play_game(&game, settings);
+    delete_game(&game);
+    return;
+}
+
+
+// Play a game of the computer against itself without printing the board
+// Each player has its own engine (indexed by the player id)
+// The moves are stored in the record and the winner is returned
+// The game is published to the spectators (if not NULL)
+int play_computer_game(
+    Engine** engines, 
+    GameRecord* record, 
+    SpectatorFeed* spectators
+) {
     // Initialize board
     Board* board = create_board();
     AdjacencyMatrix* adjacency_matrix = create_adjacency_matrix(NUM_NODES);
+    if (spectators != NULL) {
+        publish_spectator_event(
+            spectators, 
+            spectator_game_start, 
+            board, 
+            SPECTATOR_NO_MOVE
+        );
+    }
 
-    // Show board
-    print_board(board);
-    
-    // Initialize game related varibles
+    // Both players use the same search, so each turn the computer is the
+    // turn player and the opponent is the other player
     bool winner_found = false;
-    int num_rounds = MAX_TURNS;
+    bool stuck = false;
+    for (int i = 0; i < MAX_TURNS * 2 && !winner_found && !stuck; i++) {
+        board->turn_player = (i % 2 == 0) ? id_player_1 : id_player_2;
+        int opponent_id = (
+            (board->turn_player == id_player_1) ? id_player_2 : id_player_1
+        );
 
-    // While there is no winner and rounds are not over
-    for (int i = 0; i < num_rounds && !winner_found; i++) {
-        printf("Rodada %d\n", i + 1);
-        
-        // First player plays
-        board->turn_player = id_player_1;
-        if (board->turn_player == player_id) {
-            // Make the player's turn
-            play_user_turn(board, adjacency_matrix);
+        Move* move = get_computer_move(
+            engines[board->turn_player],
+            board, 
+            opponent_id, 
+            board->turn_player, 
+            adjacency_matrix
+        );
+        // A player without valid moves ends the game as a draw
+        if (move == NULL) {
+            stuck = true;
         } else {
-            // Make the computer's turn
-            play_computer_turn(board, player_id, computer_id, adjacency_matrix);
-        }
-
-        // Verify if the first player has won
-        winner_found = player_is_winner(board);
-        int winner = (winner_found) ? board->turn_player : id_empty;
-        // If no winner found, second player plays
-        if (!winner_found) {
-            print_board(board);
-            // Change turn player
-            board->turn_player = id_player_2;
-            if (board->turn_player == player_id) {
-                // Make the player's turn
-                play_user_turn(board, adjacency_matrix);
-            } else {
-                // Make the computer's turn
-                play_computer_turn(
+            make_move(board, *move, adjacency_matrix);
+            add_move_to_record(record, *move);
+            if (spectators != NULL) {
+                publish_spectator_event(
+                    spectators, 
+                    spectator_move, 
                     board, 
-                    player_id, 
-                    computer_id, 
-                    adjacency_matrix
+                    encode_move(*move)
                 );
             }
-            // Verify if the second player has won
+            free_tracked(move);
             winner_found = player_is_winner(board);
-            winner = (winner_found) ? board->turn_player : id_empty;
         }
+    }
+    if (winner_found) {
+        board->winner = board->turn_player;
+    }
+    record->result = board->winner;
+    if (spectators != NULL) {
+        publish_spectator_event(
+            spectators, 
+            spectator_game_end, 
+            board, 
+            SPECTATOR_NO_MOVE
+        );
+    }
+
+    int winner = board->winner;
+    delete_board(board);
+    delete_adjacency_matrix(adjacency_matrix);
+    return winner;
+}
+
+
+// Play games of the computer against itself
+// Each game uses its own seed (settings seed + game number). The engine of
+// the first player uses the seed and the other one its complement.
+void self_play(int num_games, GameSettings* settings) {
+    Engine* engines[2];
+    engines[id_player_1] = create_engine(0, &(settings->engine->config));
+    engines[id_player_2] = create_engine(0, &(settings->engine->config));
+
+    int wins[3] = {0, 0, 0};
+    for (int i = 0; i < num_games; i++) {
+        uint64_t seed = settings->seed + i;
+        seed_engine(engines[id_player_1], seed);
+        seed_engine(engines[id_player_2], ~seed);
+
+        GameRecord record;
+        init_game_record(&record, settings->variant, seed);
+        int winner;
+        if (settings->variant == VARIANT_CLASSIC) {
+            winner = play_computer_game(
+                engines, 
+                &record, 
+                settings->spectators
+            );
+        } else {
+            // The other variants are played only by the fast search
+            winner = play_variant_game(
+                &(variant_rules[settings->variant]), 
+                engines, 
+                &record
+            );
+        }
+        wins[winner]++;
 
-        // If a winner is found, set the winner
-        if (winner_found) {
-            board->winner = winner;
+        if (settings->record_writer != NULL) {
+            write_game_record(settings->record_writer, &record);
         }
-        // Print the board after the turn
-        print_board(board);
+        printf(
+            "Partida %d: %s (%d jogadas)\n", 
+            i + 1,
+            (winner == id_player_1) ? "vitoria de X" 
+            : (winner == id_player_2) ? "vitoria de O" : "empate",
+            record.num_moves
+        );
     }
+    printf(
+        "Vitorias de %c: %d, vitorias de %c: %d, empates: %d\n",
+        PLAYER_1, wins[id_player_1], PLAYER_2, wins[id_player_2],
+        wins[id_empty]
+    );
 
-    // Print the winner
-    if (board->winner == id_empty) {
-        printf("Empate!\n");
-    } else {
-        printf("Jogador %c venceu!\n", get_symbol_from_player(board->winner));
+    // Keep the times and the memory of both players for the statistics
+    for (int id = id_player_1; id <= id_player_2; id++) {
+        merge_latency_histogram(
+            &(settings->engine->move_memory), 
+            &(engines[id]->move_memory)
+        );
+        merge_latency_histogram(
+            &(settings->engine->move_allocations), 
+            &(engines[id]->move_allocations)
+        );
     }
-    
-    // Free the allocated memory for the board
-    delete_board(board);
-    delete_adjacency_matrix(adjacency_matrix);
+    for (int ply = 0; ply < MAX_RECORD_MOVES; ply++) {
+        merge_latency_histogram(
+            &(settings->engine->move_latency[ply]), 
+            &(engines[id_player_1]->move_latency[ply])
+        );
+        merge_latency_histogram(
+            &(settings->engine->move_latency[ply]), 
+            &(engines[id_player_2]->move_latency[ply])
+        );
+    }
+
+    delete_engine(engines[id_player_1]);
+    delete_engine(engines[id_player_2]);
     return;
 }
 
@@ -1612,11 +9982,8 @@ int get_menu_option() {
 }
 
 
-// Main function to run the game
-int main() {
-    // Seed the random number generator
-    srand(time(NULL));
-
+// Show the menu and play the chosen game mode
+void run_menu(GameSettings* settings) {
     // Print rules and welcome message
     bool valid_option;
     printf("Bem-vindo ao jogo do pe de galinha!\n");
@@ -1636,17 +10003,17 @@ int main() {
             // Player vs Player
             case 1:
                 valid_option = true;
-                player_vs_player();
+                player_vs_player(settings);
                 break;
             // Player vs Computer (Player 1 starts)
             case 2:
                 valid_option = true;
-                player_vs_computer(true);
+                player_vs_computer(true, settings);
                 break;
             // Player vs Computer (Player 2 starts)
             case 3:
                 valid_option = true;
-                player_vs_computer(false);
+                player_vs_computer(false, settings);
                 break;
             // Exit the game
             case 4:
@@ -1659,7 +10026,367 @@ int main() {
                 break;
         }
     } while (!valid_option);
-    // Create the board
-    printf("Programa finalizado.\n");
-    return 0;
-}
\ No newline at end of file
+    return;
+}
+
+
+// Print the command line usage
+void print_usage(const char* program) {
+    printf("Uso: %s [opcoes] [comando]\n", program);
+    printf("Comandos:\n");
+    printf("  (nenhum)             menu interativo\n");
+    printf("  selfplay <n>         computador contra computador, n partidas\n");
+    printf("  records <arquivo>    resumo de um arquivo de partidas\n");
+    printf("  analyze [arquivo]    analisa posicoes (uma por linha)\n");
+    printf("  replay <arquivo>     reproduz partidas (uma por linha, - = entrada)\n");
+    printf("  graph <arquivo>      grava o grafo de todas as posicoes\n");
+    printf("  solve <arquivo>      resolve a variante (continua o arquivo)\n");
+    printf("  dot <arquivo>        arvore de busca (--dump-tree) em DOT\n");
+    printf("  review <arquivo>     procura erros nas partidas gravadas\n");
+    printf("  tune <arquivo>       ajusta os pesos da avaliacao com partidas\n");
+    printf("  prove <posicao>      prova (ou refuta) uma vitoria forcada\n");
+    printf("  verify <n>           compara a busca rapida com a original\n");
+    printf("  index <arquivo>      indexa as posicoes de um arquivo de partidas\n");
+    printf("  query <posicao>      partidas que passaram pela posicao (--index)\n");
+    printf("  load <n>             n partidas pedindo jogadas ao mesmo tempo\n");
+    printf("  tournament \"<c> <c>\" torneio entre configuracoes, por exemplo\n"
+        "                       \"depth=10 depth=6,eval=0 type=pns,nodes=5000\"\n");
+    printf("Opcoes:\n");
+    printf("  --record <arquivo>   grava as partidas no arquivo\n");
+    printf("  --threads <n>        numero de threads (padrao: nucleos)\n");
+    printf("  --seed <n>           semente dos numeros aleatorios\n");
+    printf("  --no-reuse           nao reaproveita a busca entre jogadas\n");
+    printf("  --depth <n>          altura maxima da busca (padrao: %d)\n", 
+        MAX_TREE_HEIGHT);
+    printf("  --no-eval            empate no limite da busca (sem avaliacao)\n");
+    printf("  --weights <m,c,a,d>  pesos da avaliacao (mobilidade, centro,\n"
+        "                       ameacas, distancia)\n");
+    printf("  --nodes <n>          limite de nos das buscas\n");
+    printf("  --games <n>          partidas por cor de cada par (padrao: %d)\n",
+        TOURNAMENT_DEFAULT_GAMES);
+    printf("  --latency <ms>       latencia alvo das jogadas (load, padrao: %d)\n",
+        SCHEDULER_DEFAULT_LATENCY);
+    printf("  --checkpoint <arq>   salva a partida a cada jogada\n");
+    printf("  --resume <arquivo>   continua as partidas salvas\n");
+    printf("  --index <arquivo>    indice das partidas (query)\n");
+    printf("  --spectators <n>     espectadores das partidas\n");
+    printf("  --watch <arquivo>    um espectador grava as partidas no arquivo\n");
+    printf("  --plies <n>          jogadas ate o empate (prove, padrao: %d)\n",
+        MAX_TURNS * 2);
+    printf("  --trace <arquivo>    grava os tempos da busca (Chrome trace)\n");
+    printf("  --trace-height <n>   altura maxima no trace (padrao: %d)\n",
+        TRACE_DEFAULT_HEIGHT);
+    printf("  --dump-tree <arq>    grava os nos das buscas do computador\n");
+    printf("  --top <n>            melhores filhos de cada no (dot, padrao: %d)\n",
+        TREE_DOT_DEFAULT_TOP);
+    printf("  --dot-height <n>     altura maxima (dot, padrao: %d)\n",
+        TREE_DOT_DEFAULT_HEIGHT);
+    printf("  --variant <nome>     regras do selfplay: classic (padrao),\n"
+        "                       shisima, tapatan ou achi\n");
+    printf("  --stats              mostra as estatisticas do computador no fim\n");
+    printf("  --quiet              nao mostra o tabuleiro\n");
+    printf("  --render <modo>      full (padrao), diff ou quiet\n");
+    return;
+}
+
+
+// Main function to run the game
+int main(int argc, char** argv) {
+    GameSettings settings;
+    // The seed can be changed with --seed
+    settings.seed = (uint64_t) time(NULL);
+    settings.record_writer = NULL;
+    settings.num_threads = get_number_of_cores();
+    settings.print_stats = false;
+    settings.variant = VARIANT_CLASSIC;
+    settings.checkpoint_path = NULL;
+    settings.waiting_games = NULL;
+    settings.num_waiting_games = 0;
+    settings.spectators = NULL;
+    compile_all_rules();
+    init_position_index(&position_index, NUM_PIECES);
+    BoardRenderer renderer;
+    init_board_renderer(&renderer, render_full);
+    EngineConfig engine_config;
+    init_engine_config(&engine_config);
+    settings.renderer = &renderer;
+
+    // Read the options and the command
+    const char* record_path = NULL;
+    const char* trace_path = NULL;
+    const char* index_path = NULL;
+    const char* resume_path = NULL;
+    const char* watch_path = NULL;
+    const char* dump_path = NULL;
+    int dot_top = TREE_DOT_DEFAULT_TOP;
+    int dot_height = TREE_DOT_DEFAULT_HEIGHT;
+    int num_spectators = 0;
+    int trace_height = TRACE_DEFAULT_HEIGHT;
+    int plies_left = MAX_TURNS * 2;
+    int games_per_colour = TOURNAMENT_DEFAULT_GAMES;
+    int target_latency = SCHEDULER_DEFAULT_LATENCY;
+    const char* command = NULL;
+    const char* command_arg = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            settings.num_threads = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            settings.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--no-reuse") == 0) {
+            engine_config.reuse_tree = false;
+        } else if (strcmp(argv[i], "--depth") == 0 && i + 1 < argc) {
+            engine_config.max_height = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--no-eval") == 0) {
+            engine_config.use_evaluation = false;
+        } else if (strcmp(argv[i], "--weights") == 0 && i + 1 < argc) {
+            if (!parse_eval_weights(argv[++i], engine_config.eval_weights)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) {
+            engine_config.max_nodes = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--plies") == 0 && i + 1 < argc) {
+            plies_left = max(0, min(MAX_RECORD_MOVES, atoi(argv[++i])));
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            settings.checkpoint_path = argv[++i];
+        } else if (strcmp(argv[i], "--resume") == 0 && i + 1 < argc) {
+            resume_path = argv[++i];
+        } else if (strcmp(argv[i], "--index") == 0 && i + 1 < argc) {
+            index_path = argv[++i];
+        } else if (strcmp(argv[i], "--spectators") == 0 && i + 1 < argc) {
+            num_spectators = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watch_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace-height") == 0 && i + 1 < argc) {
+            trace_height = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--dump-tree") == 0 && i + 1 < argc) {
+            dump_path = argv[++i];
+        } else if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            dot_top = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--dot-height") == 0 && i + 1 < argc) {
+            dot_height = max(0, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--games") == 0 && i + 1 < argc) {
+            games_per_colour = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            target_latency = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--variant") == 0 && i + 1 < argc) {
+            settings.variant = find_variant(argv[++i]);
+            if (settings.variant == -1) {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            settings.print_stats = true;
+            memory_accounting = true;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            renderer.mode = render_quiet;
+        } else if (strcmp(argv[i], "--render") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "full") == 0) {
+                renderer.mode = render_full;
+            } else if (strcmp(argv[i], "diff") == 0) {
+                renderer.mode = render_diff;
+            } else if (strcmp(argv[i], "quiet") == 0) {
+                renderer.mode = render_quiet;
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            print_usage(argv[0]);
+            return 1;
+        } else if (command == NULL) {
+            command = argv[i];
+        } else if (command_arg == NULL) {
+            command_arg = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (trace_path != NULL) {
+        start_trace(trace_path, trace_height);
+    }
+    if (dump_path != NULL && !start_tree_dump(dump_path)) {
+        printf("Nao foi possivel criar o arquivo %s.\n", dump_path);
+        return 1;
+    }
+
+    // Create the computer player with the chosen seed
+    settings.engine = create_engine(settings.seed, &engine_config);
+
+    // Open the record file
+    if (record_path != NULL) {
+        settings.record_writer = open_record_writer(record_path);
+        if (settings.record_writer == NULL) {
+            printf("Nao foi possivel abrir o arquivo %s.\n", record_path);
+            return 1;
+        }
+    }
+
+    // Start the spectators (one more to write the frames with --watch)
+    FILE* watch_file = NULL;
+    if (watch_path != NULL) {
+        watch_file = fopen(watch_path, "w");
+        if (watch_file == NULL) {
+            printf("Nao foi possivel abrir o arquivo %s.\n", watch_path);
+            return 1;
+        }
+        num_spectators = max(1, num_spectators);
+    }
+    if (num_spectators > 0) {
+        settings.spectators = create_spectator_feed(
+            num_spectators, 
+            settings.num_threads, 
+            watch_file
+        );
+    }
+
+    int status = 0;
+    if (command == NULL && resume_path != NULL) {
+        // The resumed games keep being saved on the same file by default
+        if (settings.checkpoint_path == NULL) {
+            settings.checkpoint_path = resume_path;
+        }
+        status = resume_games(resume_path, &settings) ? 0 : 1;
+        printf("Programa finalizado.\n");
+    } else if (command == NULL) {
+        run_menu(&settings);
+        printf("Programa finalizado.\n");
+    } else if (strcmp(command, "selfplay") == 0 && command_arg != NULL) {
+        self_play(atoi(command_arg), &settings);
+    } else if (strcmp(command, "records") == 0 && command_arg != NULL) {
+        print_records_summary(command_arg);
+    } else if (strcmp(command, "index") == 0 && command_arg != NULL) {
+        status = build_game_index(command_arg) ? 0 : 1;
+    } else if (strcmp(command, "query") == 0 && command_arg != NULL 
+        && index_path != NULL) {
+        status = query_game_index(index_path, command_arg) ? 0 : 1;
+    } else if (strcmp(command, "tune") == 0 && command_arg != NULL) {
+        int weights[NUM_EVAL_FEATURES];
+        if (tune_eval_weights(command_arg, weights)) {
+            printf(
+                "Pesos: --weights %d,%d,%d,%d\n", 
+                weights[feature_mobility], 
+                weights[feature_center], 
+                weights[feature_threats], 
+                weights[feature_line_distance]
+            );
+        } else {
+            printf("Nenhuma partida lida de %s.\n", command_arg);
+            status = 1;
+        }
+    } else if (strcmp(command, "prove") == 0 && command_arg != NULL) {
+        int max_nodes = engine_config.max_nodes;
+        print_proof(
+            command_arg, 
+            plies_left, 
+            (max_nodes > 0) ? max_nodes : PROOF_DEFAULT_NODES
+        );
+    } else if (strcmp(command, "tournament") == 0 && command_arg != NULL) {
+        bool played = run_tournament(
+            command_arg, 
+            games_per_colour, 
+            settings.num_threads, 
+            settings.seed, 
+            &engine_config
+        );
+        status = played ? 0 : 1;
+    } else if (strcmp(command, "verify") == 0 && command_arg != NULL) {
+        int num_positions = max(1, atoi(command_arg));
+        bool equal = verify_fast_search(
+            num_positions, 
+            settings.seed, 
+            &engine_config
+        ) == 0;
+        status = equal ? 0 : 1;
+    } else if (strcmp(command, "load") == 0 && command_arg != NULL) {
+        run_load_test(
+            max(1, atoi(command_arg)), 
+            settings.num_threads, 
+            settings.seed, 
+            &engine_config, 
+            (uint64_t) target_latency * 1000
+        );
+    } else if (strcmp(command, "dot") == 0 && command_arg != NULL) {
+        bool converted = convert_tree_dump_to_dot(
+            command_arg, 
+            stdout, 
+            dot_top, 
+            dot_height
+        );
+        status = converted ? 0 : 1;
+    } else if (strcmp(command, "graph") == 0 && command_arg != NULL) {
+        status = export_game_graph(command_arg, settings.variant) ? 0 : 1;
+    } else if (strcmp(command, "solve") == 0 && command_arg != NULL) {
+        bool solved = solve_variant(
+            command_arg, 
+            settings.variant, 
+            settings.num_threads
+        );
+        status = solved ? 0 : 1;
+    } else if (strcmp(command, "review") == 0 && command_arg != NULL) {
+        bool reviewed = review_games(
+            command_arg, 
+            stdout, 
+            settings.num_threads, 
+            &engine_config
+        );
+        status = reviewed ? 0 : 1;
+    } else if (strcmp(command, "replay") == 0 && command_arg != NULL) {
+        // Fail if any game has an illegal move
+        status = (replay_script(command_arg) == 0) ? 0 : 1;
+    } else if (strcmp(command, "analyze") == 0) {
+        // Read from the file or from the standard input
+        FILE* input = (command_arg != NULL) ? fopen(command_arg, "r") : stdin;
+        if (input == NULL) {
+            printf("Nao foi possivel abrir o arquivo %s.\n", command_arg);
+            status = 1;
+        } else {
+            analyze_positions(
+                input, 
+                stdout, 
+                settings.num_threads, 
+                settings.seed,
+                &engine_config
+            );
+            if (input != stdin) {
+                fclose(input);
+            }
+        }
+    } else {
+        print_usage(argv[0]);
+        status = 1;
+    }
+
+    if (settings.spectators != NULL) {
+        close_spectator_feed(settings.spectators);
+    }
+    if (watch_file != NULL) {
+        fclose(watch_file);
+    }
+
+    if (settings.print_stats) {
+        print_latency_stats(&(settings.engine), 1);
+        print_memory_stats(&(settings.engine), 1);
+    }
+    if (!write_trace()) {
+        status = 1;
+    }
+    if (!finish_tree_dump()) {
+        status = 1;
+    }
+
+    // Write the pending records
+    if (settings.record_writer != NULL) {
+        close_record_writer(settings.record_writer);
+    }
+    delete_engine(settings.engine);
+
+    return status;
+}